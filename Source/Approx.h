@@ -1,4 +1,7 @@
 #pragma once
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 
 namespace approx {
     static constexpr float Pi = 3.14159265359f;
@@ -28,4 +31,31 @@ namespace approx {
         const auto x8 = x6 * x * x;
         return 1.f - x2 * .5f + x4 * .0416666666667f - x6 * .00138888888889f + x8 * .0000248015873016f;
     }
+    /*
+    * ranges:
+    * x [-87, 0]; y [0, 1], rel. error < 5e-6
+    */
+    static inline float exp(float x) noexcept {
+        // 2^(x / ln2): the integer part goes into the exponent bits, the fraction into a taylor series
+        x = x < -87.f ? -87.f : x;
+        const auto y = x * 1.44269504089f;
+        const auto n = std::round(y);
+        const auto f = (y - n) * .69314718056f;
+        const auto p = 1.f + f * (1.f + f * (.5f + f * (.166666666667f + f * (.0416666666667f
+            + f * (.00833333333333f + f * .00138888888889f)))));
+        const auto bits = static_cast<uint32_t>(static_cast<int32_t>(n) + 127) << 23;
+        float scale;
+        std::memcpy(&scale, &bits, sizeof(float));
+        return p * scale;
+    }
+    /*
+    * 1 - e^-x, stays precise for tiny x (long smoothing times)
+    * ranges:
+    * x [0, inf]; y [0, 1]
+    */
+    static inline float oneMinusExp(const float x) noexcept {
+        if (x < .125f)
+            return x * (1.f - x * (.5f - x * (.166666666667f - x * (.0416666666667f - x * .00833333333333f))));
+        return 1.f - exp(-x);
+    }
 }
\ No newline at end of file
@@ -6,60 +6,81 @@ namespace interpolation
 {
 	static constexpr float Pi = 3.14159265359f;
 	
-	static float sinc(const float xPi) noexcept { return std::sin(xPi) / xPi; }
+	template<typename Float>
+	static Float sinc(const Float xPi) noexcept { return std::sin(xPi) / xPi; }
 
 	namespace window
 	{
-		static float lanczos(const float xPi, const float alphaInv) noexcept { return sinc(xPi * alphaInv); }
-		static float circular(const float x, const float alphaInv) noexcept {
+		template<typename Float>
+		static Float lanczos(const Float xPi, const Float alphaInv) noexcept { return sinc(xPi * alphaInv); }
+		template<typename Float>
+		static Float circular(const Float x, const Float alphaInv) noexcept {
 			const auto a = x * alphaInv;
-			return std::sqrt(1.f - a * a);
+			return std::sqrt(static_cast<Float>(1) - a * a);
 		}
 	}
 
-	static float lanczosSinc(const float* buffer, const float readHead, const int size, const int alpha) noexcept
+	/*
+	* all ring buffer interpolators come in 2 flavours:
+	* readHead: position as one floating point number
+	* iFloor, x: position as integer index + fraction [0, 1]
+	* the latter keeps full precision in the fraction, no matter how big the buffer is
+	*/
+
+	template<typename Float>
+	static Float lanczosSinc(const Float* buffer, const int iFloor, const Float x, const int size, const int alpha) noexcept
 	{
-		const auto iFloor = std::floor(readHead);
-		const auto iFloorInt = static_cast<int>(iFloor);
-		const auto x = readHead - iFloor;
-		const auto alphaInv = 1.f / static_cast<float>(alpha);
+		const auto alphaF = static_cast<Float>(alpha);
+		const auto alphaInv = static_cast<Float>(1) / alphaF;
+		const auto pi = static_cast<Float>(Pi);
 		
-		auto sum = 0.f;
+		auto sum = static_cast<Float>(0);
 		for (auto i = -alpha; i <= alpha; ++i) {
-			const auto lx = x - static_cast<float>(i);
-			float ly;
-			if (lx == 0.f) ly = 1.f;
-			else if (-alpha < lx && lx <= alpha) {
-				const auto lxPi = lx * Pi;
+			const auto lx = x - static_cast<Float>(i);
+			Float ly;
+			if (lx == static_cast<Float>(0)) ly = static_cast<Float>(1);
+			else if (-alphaF < lx && lx <= alphaF) {
+				const auto lxPi = lx * pi;
 				ly = sinc(lxPi) * sinc(lxPi * alphaInv);
 			}
-			else ly = 0.f;
+			else ly = static_cast<Float>(0);
 
-			auto idx = iFloorInt + i;
+			auto idx = iFloor + i;
 			if (idx < 0) idx += size;
 			else if (idx >= size) idx -= size;
 			sum += ly * buffer[idx];
 		}
 		return sum;
 	}
+	template<typename Float>
+	static Float lanczosSinc(const Float* buffer, const Float readHead, const int size, const int alpha) noexcept
+	{
+		const auto iFloor = std::floor(readHead);
+		return lanczosSinc(buffer, static_cast<int>(iFloor), readHead - iFloor, size, alpha);
+	}
 
-	static float lerp(float a, float b, float x) noexcept { return a + x * (b - a); }
+	template<typename Float>
+	static Float lerp(Float a, Float b, Float x) noexcept { return a + x * (b - a); }
 
-	static float lerp(const float* buffer, const float readHead, const int size)
+	template<typename Float>
+	static Float lerp(const Float* buffer, const int i0, const Float x, const int size) noexcept
 	{
-		const auto iFloor = std::floor(readHead);
-		const auto i0 = static_cast<int>(iFloor);
 		auto i1 = i0 + 1;
 		if (i1 >= size)
 			i1 -= size;
-		const auto x = readHead - iFloor;
 		return lerp(buffer[i0], buffer[i1], x);
 	}
-
-	static float cubicHermiteSpline(const float* buffer, const float readHead, const int size) noexcept
+	template<typename Float>
+	static Float lerp(const Float* buffer, const Float readHead, const int size) noexcept
 	{
 		const auto iFloor = std::floor(readHead);
-		auto i1 = static_cast<int>(iFloor);
+		return lerp(buffer, static_cast<int>(iFloor), readHead - iFloor, size);
+	}
+
+	template<typename Float>
+	static Float cubicHermiteSpline(const Float* buffer, const int iFloor, const Float t, const int size) noexcept
+	{
+		auto i1 = iFloor;
 		auto i0 = i1 - 1;
 		auto i2 = i1 + 1;
 		auto i3 = i1 + 2;
@@ -67,20 +88,26 @@ namespace interpolation
 		if (i2 >= size) i2 -= size;
 		if (i0 < 0) i0 += size;
 
-		const auto t = readHead - iFloor;
 		const auto v0 = buffer[i0];
 		const auto v1 = buffer[i1];
 		const auto v2 = buffer[i2];
 		const auto v3 = buffer[i3];
 
 		const auto c0 = v1;
-		const auto c1 = .5f * (v2 - v0);
-		const auto c2 = v0 - 2.5f * v1 + 2.f * v2 - .5f * v3;
-		const auto c3 = 1.5f * (v1 - v2) + .5f * (v3 - v0);
+		const auto c1 = static_cast<Float>(.5) * (v2 - v0);
+		const auto c2 = v0 - static_cast<Float>(2.5) * v1 + static_cast<Float>(2) * v2 - static_cast<Float>(.5) * v3;
+		const auto c3 = static_cast<Float>(1.5) * (v1 - v2) + static_cast<Float>(.5) * (v3 - v0);
 
 		return ((c3 * t + c2) * t + c1) * t + c0;
 	}
-	static float cubicHermiteSpline(const float* buffer, const float readHead) noexcept
+	template<typename Float>
+	static Float cubicHermiteSpline(const Float* buffer, const Float readHead, const int size) noexcept
+	{
+		const auto iFloor = std::floor(readHead);
+		return cubicHermiteSpline(buffer, static_cast<int>(iFloor), readHead - iFloor, size);
+	}
+	template<typename Float>
+	static Float cubicHermiteSpline(const Float* buffer, const Float readHead) noexcept
 	{
 		const auto iFloor = std::floor(readHead);
 		const auto i0 = static_cast<int>(iFloor);
@@ -95,30 +122,35 @@ namespace interpolation
 		const auto v3 = buffer[i3];
 
 		const auto c0 = v1;
-		const auto c1 = .5f * (v2 - v0);
-		const auto c2 = v0 - 2.5f * v1 + 2.f * v2 - .5f * v3;
-		const auto c3 = 1.5f * (v1 - v2) + .5f * (v3 - v0);
+		const auto c1 = static_cast<Float>(.5) * (v2 - v0);
+		const auto c2 = v0 - static_cast<Float>(2.5) * v1 + static_cast<Float>(2) * v2 - static_cast<Float>(.5) * v3;
+		const auto c3 = static_cast<Float>(1.5) * (v1 - v2) + static_cast<Float>(.5) * (v3 - v0);
 
 		return ((c3 * t + c2) * t + c1) * t + c0;
 	}
 	
-	static float lagrange(const float* buffer, const float readHead, const int size, const int N)
+	template<typename Float>
+	static Float lagrange(const Float* buffer, const int iFloor, const Float x, const int size, const int N) noexcept
 	{
-		const float iFloor = std::floor(readHead);
-		const int iFloorInt = static_cast<int>(iFloor);
-		float yp = 0.f;
+		Float yp = static_cast<Float>(0);
 		for (int i = 0; i < N; ++i) {
-			float p = 1.f;
+			Float p = static_cast<Float>(1);
 			for (int j = 0; j < N; ++j)
 				if (j != i)
-					p *= (readHead - static_cast<float>(iFloorInt + j)) / static_cast<float>(i - j);
-			int idx = iFloorInt + i;
+					p *= (x - static_cast<Float>(j)) / static_cast<Float>(i - j);
+			int idx = iFloor + i;
 			if (idx >= size)
 				idx -= size;
 			yp += p * buffer[idx];
 		}
 		return yp;
 	}
+	template<typename Float>
+	static Float lagrange(const Float* buffer, const Float readHead, const int size, const int N) noexcept
+	{
+		const auto iFloor = std::floor(readHead);
+		return lagrange(buffer, static_cast<int>(iFloor), readHead - iFloor, size, N);
+	}
 }
 
 /*
@@ -27,7 +27,7 @@ Nel19AudioProcessorEditor::Nel19AudioProcessorEditor(Nel19AudioProcessor& p) :
     ),
     layoutMainParams(
         { 50, 80 },
-        { 90, 90, 90, 40 }
+        { 90, 90, 90, 40, 60 }
     ),
     layoutBottomBar(
         { 250, 90 },
@@ -58,8 +58,10 @@ Nel19AudioProcessorEditor::Nel19AudioProcessorEditor(Nel19AudioProcessor& p) :
 
     modComps
     {
-        modSys6::gui::ModComp(utils, modulatables, audioProcessor.modulators[0].getTables(), 0),
-        modSys6::gui::ModComp(utils, modulatables, audioProcessor.modulators[1].getTables(), modSys6::NumParamsPerMod)
+        modSys6::gui::ModComp(utils, modulatables, audioProcessor.modulators[0].getTablesBuilder(), audioProcessor.modulators[0].getEnvFolSettings(),
+            audioProcessor.modulators[0].getCurveLoader(), 0),
+        modSys6::gui::ModComp(utils, modulatables, audioProcessor.modulators[1].getTablesBuilder(), audioProcessor.modulators[1].getEnvFolSettings(),
+            audioProcessor.modulators[1].getCurveLoader(), modSys6::NumParamsPerMod)
     },
 
     modsDepth(utils, "Depth", "Modulate the depth of the vibrato.", modSys6::PID::Depth, modulatables, modSys6::gui::ParameterType::Knob),
@@ -67,6 +69,8 @@ Nel19AudioProcessorEditor::Nel19AudioProcessorEditor(Nel19AudioProcessor& p) :
     dryWetMix(utils, "Mix", "Define the dry/wet ratio of the effect.", modSys6::PID::DryWetMix, modulatables, modSys6::gui::ParameterType::Knob),
     gainWet(utils, "Gain", "The output gain of the wet signal.", modSys6::PID::WetGain, modulatables, modSys6::gui::ParameterType::Knob),
     stereoConfig(utils, "StereoConfig", "Configurate if effect is applied to l/r or m/s", modSys6::PID::StereoConfig, modulatables, modSys6::gui::ParameterType::Switch),
+    freeze(utils, "Freeze", "Record the modulation and loop it instead of running the modulators.", modSys6::PID::Freeze, modulatables, modSys6::gui::ParameterType::Switch),
+    freezeBars(utils, "Bars", "The length of the frozen loop. Synced to the host it starts on the next bar.", modSys6::PID::FreezeBars, modulatables, modSys6::gui::ParameterType::Knob),
 
     macro0Dragger(utils, modSys6::ModType::Macro, 0, modulatables),
     macro1Dragger(utils, modSys6::ModType::Macro, 1, modulatables),
@@ -133,6 +137,8 @@ Nel19AudioProcessorEditor::Nel19AudioProcessorEditor(Nel19AudioProcessor& p) :
     addAndMakeVisible(dryWetMix);
     addAndMakeVisible(gainWet);
     addAndMakeVisible(stereoConfig);
+    addAndMakeVisible(freeze);
+    addAndMakeVisible(freezeBars);
 
     addAndMakeVisible(macro0Dragger);
     addAndMakeVisible(macro1Dragger);
@@ -153,7 +159,7 @@ Nel19AudioProcessorEditor::Nel19AudioProcessorEditor(Nel19AudioProcessor& p) :
         auto& modComp = modComps[m];
         modComp.onModChange = [this, m](vibrato::ModType t)
         {
-            audioProcessor.modType[m] = t;
+            audioProcessor.setModType(m, t);
         };
         modComp.setMod(p.modType[m]);
         modComp.addButtonsToRandomizer(paramRandomizer);
@@ -163,9 +169,10 @@ Nel19AudioProcessorEditor::Nel19AudioProcessorEditor(Nel19AudioProcessor& p) :
         };
     }
 
-    paramRandomizer.add([this](juce::Random& rand)
+    paramRandomizer.add([this](prng::Xoshiro128& rand)
     {
-        const auto numMods = static_cast<float>(vibrato::ModType::NumMods);
+        // curves need a file, so they are left out
+        const auto numMods = static_cast<float>(vibrato::ModType::Curve);
         for (auto m = 0; m < modComps.size(); ++m)
         {
             const auto val = rand.nextFloat() * (numMods - .1f);
@@ -251,6 +258,8 @@ void Nel19AudioProcessorEditor::resized()
     layoutMainParams.place(dryWetMix,    1, 2, 1, 1, thicc, true);
     layoutMainParams.place(gainWet,      0, 2, 1, 1, thicc, true);
     layoutMainParams.place(stereoConfig, 0, 3, 2, 1, thicc, true);
+    layoutMainParams.place(freeze,       0, 4, 1, 1, thicc, true);
+    layoutMainParams.place(freezeBars,   1, 4, 1, 1, thicc, true);
 
     layout.place(presetBrowser, 1, 1, 2, 3, thicc, false);
 
@@ -10,6 +10,7 @@ Nel19AudioProcessor::Nel19AudioProcessor()
                      #if ! JucePlugin_IsMidiEffect
                       #if ! JucePlugin_IsSynth
                        .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
+                       .withInput  ("Sidechain", juce::AudioChannelSet::stereo(), false)
                       #endif
                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
                      #endif
@@ -19,25 +20,31 @@ Nel19AudioProcessor::Nel19AudioProcessor()
 
     dryWet(numChannels),
 
-    modSys(*this, [this]() { loadPatch(); }),
+    modSys(*this, [this]() { loadPatch(true); }),
 
     midSideProcessor(numChannels),
     oversampling(this),
 
-    modulators
-    {
-        vibrato::Modulator(numChannels, modSys.getBeatsData()),
-        vibrato::Modulator(numChannels, modSys.getBeatsData())
-    },
+    modulators(NumActiveMods, numChannels, modSys.getBeatsData()),
     modsBuffer(),
+    modsBufferLow(),
     modType(),
+    midiEvents(),
+    transport(),
+    freezer(),
 
     vibrat(modsBuffer, numChannels),
     visualizerValues(),
 
     mutex(),
     depthSmooth(), modsMixSmooth(),
-    depthBuf(), modsMixBuf()
+    depthBuf(), modsMixBuf(), modsWeights(),
+    modsUpsampler(),
+    modsUpFactor(1),
+    seed(0),
+    wasPlaying(false),
+    modsWereConstant(false), modsStatic(false),
+    modsConstValues()
 #endif
 {
     appProperties.setStorageParameters(makeOptions());
@@ -75,6 +82,7 @@ Nel19AudioProcessor::Nel19AudioProcessor()
     
 
     visualizerValues.resize(numChannels, 0.f);
+    setSeed(static_cast<uint64_t>(juce::Random::getSystemRandom().nextInt64()));
 
     modType[0] = vibrato::ModType::Perlin;
     modType[1] = vibrato::ModType::LFO;
@@ -109,7 +117,7 @@ Nel19AudioProcessor::Nel19AudioProcessor()
             const juce::Identifier id(objStr);
             const auto mID = user->getValue(id, vibrato::toString(defVals[m]));
             const auto type = vibrato::getModType(mID);
-            modType[m] = type;
+            setModType(m, type);
         }
     }
 
@@ -181,35 +189,53 @@ void Nel19AudioProcessor::prepareToPlay(double sampleRate, int maxBufferSize)
             dSize = static_cast<float>(user->getDoubleValue(id, defaultDlySize));
     }
     const auto vibSizeSamplesHalf = static_cast<int>(std::rint(sampleRateF * dSize * .001f * .5f));
+    const auto doublePrecision = isUsingDoublePrecision();
     
-    dryWet.prepare(sampleRateF, maxBufferSize, vibSizeSamplesHalf);
+    dryWet.prepare(sampleRateF, maxBufferSize, vibSizeSamplesHalf, doublePrecision);
 
     const auto lGate = dryWet.isLookaheadEnabled() ? 1 : 0;
     auto latency = vibSizeSamplesHalf;
+    
+    // MODULATORS RUN AT THE HOST'S RATE
+    const auto sampleRateLowF = sampleRateF;
+    const auto maxBufferSizeLow = maxBufferSize;
 #if OversamplingEnabled
-    oversampling.prepareToPlay(sampleRate, maxBufferSize);
+    oversampling.prepareToPlay(sampleRate, maxBufferSize, doublePrecision);
 
     sampleRate = oversampling.getSampleRateUpsampled();
     maxBufferSize = oversampling.getBlockSizeUp();
     latency += oversampling.getLatency();
-    const auto latencyUp = latency * oversampling.getUpsamplingFactor();
 
     sampleRateF = static_cast<float>(sampleRate);
 #endif
-    modSys6::Smooth::makeFromDecayInMs(depthSmooth, 24.f, sampleRateF);
-    modSys6::Smooth::makeFromDecayInMs(modsMixSmooth, 24.f, sampleRateF);
-    depthBuf.resize(maxBufferSize);
-    modsMixBuf.resize(maxBufferSize);
+    modsUpFactor = maxBufferSize / juce::jmax(maxBufferSizeLow, 1);
+    wasPlaying = false;
+    modsWereConstant = false;
+    modsStatic = false;
+    modSys6::Smooth::makeFromDecayInMs(depthSmooth, 24.f, sampleRateLowF);
+    modSys6::Smooth::makeFromDecayInMs(modsMixSmooth, 24.f, sampleRateLowF);
+    depthBuf.resize(maxBufferSizeLow);
+    modsMixBuf.resize(maxBufferSizeLow);
+    modsWeights.resize(NumActiveMods * maxBufferSizeLow);
 
     for (auto ch = 0; ch < numChannels; ++ch)
+    {
         modsBuffer[ch].resize(maxBufferSize, 0.f);
+        modsBufferLow[ch].resize(maxBufferSizeLow, 0.f);
+    }
+    {
+        const float lastValues[] = { 0.f, 0.f };
+        modsUpsampler.reset(modsUpFactor, lastValues, numChannels);
+    }
     
-    for (auto m = 0; m < NumActiveMods; ++m)
-        modulators[m].prepare(sampleRateF, maxBufferSize, latencyUp * lGate);
+    // synced lfos compensate the modsUpsampler's lag of 2 samples
+    const auto modsLatency = latency * lGate - (modsUpFactor != 1 ? 2 : 0);
+    modulators.prepare(sampleRateLowF, maxBufferSizeLow, modsLatency, modsUpFactor);
+    freezer.prepare(sampleRateLowF, modsLatency);
         
     // UPDATE LFO WAVETABLE
     const size_t vds = static_cast<size_t>(sampleRateF * dSize * .001f);
-    vibrat.resizeDelay(vds);
+    vibrat.resizeDelay(vds, doublePrecision);
     {
         const auto id = vibrato::toString(vibrato::ObjType::InterpolationType);
         const auto typeStr = modSys.state.getProperty(id, "").toString();
@@ -226,6 +252,17 @@ void Nel19AudioProcessor::prepareToPlay(double sampleRate, int maxBufferSize)
 void Nel19AudioProcessor::releaseResources() {}
 bool Nel19AudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
 {
+    { // SIDECHAIN
+        // its channels must not overlap the main output's, which get written before the modulators read them
+        const auto sidechain = layouts.inputBuses.size() > 1 ? layouts.inputBuses[1] : juce::AudioChannelSet::disabled();
+        if (sidechain != juce::AudioChannelSet::disabled())
+        {
+            if (sidechain != juce::AudioChannelSet::mono() && sidechain != juce::AudioChannelSet::stereo())
+                return false;
+            if (layouts.getMainInputChannelSet() != layouts.getMainOutputChannelSet())
+                return false;
+        }
+    }
     return
         (layouts.getMainInputChannelSet() == juce::AudioChannelSet::disabled()
         && layouts.getMainOutputChannelSet() == juce::AudioChannelSet::disabled())
@@ -236,7 +273,17 @@ bool Nel19AudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) co
         || layouts.getMainOutputChannelSet() == juce::AudioChannelSet::stereo());
 }
 
+bool Nel19AudioProcessor::supportsDoublePrecisionProcessing() const { return true; }
 void Nel19AudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midi)
+{
+    processBlockInternal(buffer, midi);
+}
+void Nel19AudioProcessor::processBlock(juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midi)
+{
+    processBlockInternal(buffer, midi);
+}
+template<typename Float>
+void Nel19AudioProcessor::processBlockInternal(juce::AudioBuffer<Float>& buffer, juce::MidiBuffer& midi)
 {
     juce::ScopedNoDenormals noDenormals;
     const auto numSamples = buffer.getNumSamples();
@@ -260,6 +307,7 @@ void Nel19AudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::M
         return;
     }
     auto samples = buffer.getArrayOfWritePointers();
+    midiEvents(midi);
 
     if (!dryWet.saveDry(samplesRead, modSys.getParam(modSys6::PID::DryWetMix)->getValueSum(), numChannelsIn, numChannelsOut, numSamples))
         return prepareToPlay(getSampleRate(), getBlockSize());
@@ -269,16 +317,17 @@ void Nel19AudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::M
     if (midSideProcessor.enabled && numChannelsIn + numChannelsOut == 4)
     {
         midSideProcessor.processBlockEncode(samples, numSamples);
-        processBlockVibrato(buffer, midi, numChannelsIn, numChannelsOut);
+        processBlockVibrato(buffer, midiEvents, numChannelsIn, numChannelsOut);
         midSideProcessor.processBlockDecode(samples, numSamples);
     }
     else
 #endif
-    processBlockVibrato(buffer, midi, numChannelsIn, numChannelsOut);
+    processBlockVibrato(buffer, midiEvents, numChannelsIn, numChannelsOut);
 
     dryWet.processWet(samples, modSys.getParam(modSys6::PID::WetGain)->getValSumDenorm(), numChannelsIn, numChannelsOut, numSamples);
 }
-void Nel19AudioProcessor::processBlockVibrato(juce::AudioBuffer<float>& b, const juce::MidiBuffer& midi, int numChannelsIn, int numChannelsOut)
+template<typename Float>
+void Nel19AudioProcessor::processBlockVibrato(juce::AudioBuffer<Float>& b, const vibrato::MidiEvents& midi, int numChannelsIn, int numChannelsOut)
 {
     auto buffer = &b;
 #if OversamplingEnabled
@@ -289,17 +338,72 @@ void Nel19AudioProcessor::processBlockVibrato(juce::AudioBuffer<float>& b, const
     }
     const bool hasUpsampled = &b != buffer;
 #endif
-    const auto samplesRead = buffer->getArrayOfReadPointers();
     const auto numSamples = buffer->getNumSamples();
+    // modulators read the input at the host's rate
+    const auto samplesReadLow = b.getArrayOfReadPointers();
+    const auto numSamplesLow = b.getNumSamples();
+
+    transport(getPlayHead());
 
-    auto curPlayHead = getPlayHead();
+    bool resetMods = false;
+    { // RESET MODULATORS ON TRANSPORT START OF OFFLINE RENDERS
+        resetMods = transport.isPlaying && !wasPlaying && isNonRealtime();
+        wasPlaying = transport.isPlaying;
+    }
+
+    const auto modsMix = modSys.getParam(modSys6::PID::ModsMix)->getValueSum();
+    const auto depth = modSys.getParam(modSys6::PID::Depth)->getValueSum();
+    if (resetMods)
+    {
+        depthSmooth.setValue(depth);
+        modsMixSmooth.setValue(modsMix);
+        const float lastValues[] = { 0.f, 0.f };
+        modsUpsampler.reset(modsUpFactor, lastValues, numChannels);
+    }
+    // must be asked before the smoothers advance
+    const auto smoothersSettled = depthSmooth.isSettled(depth) && modsMixSmooth.isSettled(modsMix);
+
+    freezer.update(
+        modSys.getParam(modSys6::PID::Freeze)->getValueSum() > .5f,
+        1 << static_cast<int>(modSys.getParam(modSys6::PID::FreezeBars)->getValSumDenorm()),
+        transport, numSamplesLow
+    );
+    const auto modsFrozen = freezer.isFrozen();
+
+    { // WEIGHT THE SLOTS
+        // modsMix travels across the slots, each one fading in and out next to its neighbours.
+        // with 2 slots that's (m0 + mix * (m1 - m0)) * depth. depth gets applied to the mix,
+        // so that it stays live while the mix is frozen
+        depthSmooth(depthBuf.data(), depth, numSamplesLow);
+        modsMixSmooth(modsMixBuf.data(), modsMix, numSamplesLow);
+        float mixMin, mixMax;
+        juce::FloatVectorOperations::findMinAndMax(modsMixBuf.data(), numSamplesLow, mixMin, mixMax);
+        static constexpr float PosMax = static_cast<float>(NumActiveMods - 1);
+        for (auto m = 0; m < NumActiveMods; ++m)
+        {
+            const auto mF = static_cast<float>(m);
+            // slots out of reach of the mix cost nothing this block, frozen ones neither.
+            // high rate slots aren't part of the recording, so they keep running on top of it
+            const auto isInReach = resetMods || (mixMax * PosMax > mF - 1.f && mixMin * PosMax < mF + 1.f);
+            const auto isActive = isInReach && (!modsFrozen || modulators[m].getRateFactor() != 1);
+            modulators.setActive(m, isActive);
+            if (isActive)
+            {
+                auto w = getModsWeights(m);
+                for (auto s = 0; s < numSamplesLow; ++s)
+                    w[s] = std::max(0.f, 1.f - std::abs(modsMixBuf[s] * PosMax - mF));
+            }
+        }
+    }
 
     // PROCESS MODULATORS
     for(auto m = 0; m < NumActiveMods; ++m)
     {
+        if (!modulators.isActive(m))
+            continue;
         auto& mod = modulators[m];
-        const auto type = modType[m];
-        mod.setType(type);
+        // the parameters go to the engine that's live, which lags modType[m] while a new one gets built
+        const auto type = mod.updateEngine();
         const auto offset = m * modSys6::NumParamsPerMod;
 
         using namespace modSys6;
@@ -362,33 +466,100 @@ void Nel19AudioProcessor::processBlockVibrato(juce::AudioBuffer<float>& b, const
                 modSys.getParam(withOffset(PID::LFO0Width, offset))->getValSumDenorm()
             );
             break;
+        case vibrato::ModType::Curve:
+            mod.setParametersCurve(
+                modSys.getParam(withCurveOffset(PID::Curve0FreeSync, offset))->getValueSum() > .5f,
+                modSys.getParam(withCurveOffset(PID::Curve0Speed, offset))->getValSumDenorm(),
+                modSys.getParam(withCurveOffset(PID::Curve0RateSync, offset))->getValSumDenorm(),
+                modSys.getParam(withCurveOffset(PID::Curve0Width, offset))->getValSumDenorm()
+            );
+            break;
         }
-        mod.processBlock(samplesRead, midi, curPlayHead, numChannelsIn, numChannelsOut, numSamples);
+        if (resetMods)
+            mod.reset();
     }
-
-    // FILL MODBUFFER WITH MODULATORS
-    {
-        const auto modsMix = modSys.getParam(modSys6::PID::ModsMix)->getValueSum();
-        const auto depth = modSys.getParam(modSys6::PID::Depth)->getValueSum();
-        for (auto s = 0; s < numSamples; ++s)
+    vibrato::AudioInput<Float> modsInput{ samplesReadLow, nullptr, numChannelsIn, 0 };
+    { // THE SIDECHAIN IS READ STRAIGHT FROM THE HOST'S BUFFER
+        const auto sidechain = getBus(true, 1);
+        if (sidechain != nullptr && sidechain->isEnabled())
         {
-            depthBuf[s] = depthSmooth(depth);
-            modsMixBuf[s] = modsMixSmooth(modsMix);
+            modsInput.sidechain = samplesReadLow + getChannelIndexInProcessBlockBuffer(true, 1, 0);
+            modsInput.numChannelsSidechain = juce::jmin(sidechain->getNumberOfChannels(), 2);
         }
+    }
+    modulators.processBlock(modsInput, midi, transport, numChannelsOut, numSamplesLow);
 
+    { // CHECK IF THE MODULATION IS CONSTANT
+        std::array<float, 2> constValues = { 0.f, 0.f };
+        auto isConstant = smoothersSettled && !freezer.isActive();
+        for (auto m = 0; m < NumActiveMods; ++m)
+            isConstant = isConstant && (!modulators.isActive(m) || modulators[m].isConstant());
+        if (isConstant)
+            for (auto ch = 0; ch < numChannelsOut; ++ch)
+                for (auto m = 0; m < NumActiveMods; ++m)
+                    if (modulators.isActive(m))
+                        constValues[ch] += modulators[m].buffer[ch][0] * getModsWeights(m)[0] * depthBuf[0];
+        // the first constant block still runs through the upsampler, so that its history settles
+        modsStatic = isConstant && modsWereConstant && constValues == modsConstValues;
+        modsWereConstant = isConstant;
+        modsConstValues = constValues;
+    }
+    if (modsStatic)
+    { // CONSTANT MODULATION, NO NEED TO MIX PER SAMPLE
         for (auto ch = 0; ch < numChannelsOut; ++ch)
         {
-            const auto m0 = modulators[0].buffer[ch].data();
-            const auto m1 = modulators[1].buffer[ch].data();
-            auto mAll = modsBuffer[ch].data();
-            for (auto s = 0; s < numSamples; ++s)
-                mAll[s] = (m0[s] + modsMixBuf[s] * (m1[s] - m0[s])) * depthBuf[s];
-            visualizerValues[ch] = mAll[numSamples - 1];
+            juce::FloatVectorOperations::fill(modsBuffer[ch].data(), modsConstValues[ch], numSamples);
+            visualizerValues[ch] = modsConstValues[ch];
+        }
+    }
+    else
+    { // FILL MODBUFFER WITH MODULATORS
+        const auto upsampleMods = numSamples != numSamplesLow;
+        auto& modsLow = upsampleMods ? modsBufferLow : modsBuffer;
+        float* mixLow[] = { modsLow[0].data(), modsLow[1].data() };
+        if (modsFrozen)
+            freezer.processBlockFrozen(mixLow, numChannelsOut, numSamplesLow, transport);
+        else
+        {
+            for (auto ch = 0; ch < numChannelsOut; ++ch)
+            { // WEIGHTED SUM OF HOST RATE MODULATORS
+                auto mLow = mixLow[ch];
+                juce::FloatVectorOperations::clear(mLow, numSamplesLow);
+                for (auto m = 0; m < NumActiveMods; ++m)
+                    if (modulators.isActive(m) && modulators[m].getRateFactor() == 1)
+                        juce::FloatVectorOperations::addWithMultiply(mLow, modulators[m].buffer[ch].data(), getModsWeights(m), numSamplesLow);
+            }
+            freezer.processBlock(mixLow, numChannelsOut, numSamplesLow, transport);
+        }
+        for (auto ch = 0; ch < numChannelsOut; ++ch)
+            juce::FloatVectorOperations::multiply(mixLow[ch], depthBuf.data(), numSamplesLow);
+        if (upsampleMods)
+        { // UPSAMPLE THEIR MIX AND ADD HIGH RATE MODULATORS
+            float* dest[] = { modsBuffer[0].data(), modsBuffer[1].data() };
+            const float* src[] = { modsBufferLow[0].data(), modsBufferLow[1].data() };
+            modsUpsampler(dest, src, numChannelsOut, numSamples);
+
+            for (auto m = 0; m < NumActiveMods; ++m)
+                if (modulators.isActive(m) && modulators[m].getRateFactor() != 1)
+                {
+                    const auto w = getModsWeights(m);
+                    for (auto ch = 0; ch < numChannelsOut; ++ch)
+                    {
+                        const auto mod = modulators[m].buffer[ch].data();
+                        auto mAll = modsBuffer[ch].data();
+                        for (auto s = 0; s < numSamples; ++s)
+                        {
+                            const auto sLow = s / modsUpFactor;
+                            mAll[s] += mod[s] * w[sLow] * depthBuf[sLow];
+                        }
+                    }
+                }
         }
+        for (auto ch = 0; ch < numChannelsOut; ++ch)
+            visualizerValues[ch] = modsBuffer[ch][numSamples - 1];
     }
 
 #if DebugModsBuffer
-    const auto depth = modSys.getParam(modSys6::PID::Depth)->getValueSum();
     for (auto ch = 0; ch < numChannelsOut; ++ch)
     {
         const auto mAll = modsBuffer[ch].data();
@@ -399,7 +570,7 @@ void Nel19AudioProcessor::processBlockVibrato(juce::AudioBuffer<float>& b, const
     }
 #else
     // PROCESS VIBRATO
-    if (!vibrat.processBlock(*buffer, this, numChannelsOut))
+    if (!vibrat.processBlock(*buffer, this, numChannelsOut, modsStatic))
         return;
 #endif
     
@@ -409,6 +580,15 @@ void Nel19AudioProcessor::processBlockVibrato(juce::AudioBuffer<float>& b, const
 #endif
 }
 void Nel19AudioProcessor::processBlockBypassed(juce::AudioBuffer<float>& buffer, juce::MidiBuffer&)
+{
+    processBlockBypassedInternal(buffer);
+}
+void Nel19AudioProcessor::processBlockBypassed(juce::AudioBuffer<double>& buffer, juce::MidiBuffer&)
+{
+    processBlockBypassedInternal(buffer);
+}
+template<typename Float>
+void Nel19AudioProcessor::processBlockBypassedInternal(juce::AudioBuffer<Float>& buffer)
 {
     juce::ScopedNoDenormals noDenormals;
     const auto numSamples = buffer.getNumSamples();
@@ -463,6 +643,10 @@ void Nel19AudioProcessor::savePatch()
     }
     for (auto m = 0; m < modulators.size(); ++m)
         modulators[m].savePatch(modSys.state, m);
+    {
+        const juce::Identifier id(vibrato::toString(vibrato::ObjType::Seed));
+        modSys.state.setProperty(id, juce::String::toHexString(static_cast<juce::int64>(seed)), nullptr);
+    }
     {
         const juce::Identifier id(vibrato::toString(vibrato::ObjType::InterpolationType));
         const auto type = vibrat.getInterpolationType();
@@ -493,14 +677,28 @@ void Nel19AudioProcessor::setStateInformation (const void* data, int sizeInBytes
         if (xmlState->hasTagName(modSys.state.getType()))
             modSys.state = juce::ValueTree::fromXml(*xmlState);
     loadPatch();
+    // the patch's engines are built here instead of on the worker, so that an offline render
+    // starting right after this already runs them
+    modulators.processRequests();
 #if RemoveValueTree
     modSys.state.removeAllChildren(nullptr);
     modSys.state.removeAllProperties(nullptr);
 #endif
 }
-void Nel19AudioProcessor::loadPatch()
+void Nel19AudioProcessor::setSeed(uint64_t s)
 {
-    modSys.loadPatch();
+    seed = s;
+    for (auto m = 0; m < NumActiveMods; ++m)
+        modulators[m].setSeed(seed, m);
+}
+void Nel19AudioProcessor::setModType(int m, vibrato::ModType t)
+{
+    modType[m] = t;
+    modulators.requestType(m, t);
+}
+void Nel19AudioProcessor::loadPatch(bool fromAudioThread)
+{
+    modSys.loadPatch(fromAudioThread);
     {
         const auto modTypeID = vibrato::toString(vibrato::ObjType::ModType);
         const auto modTypeState = modSys.state.getChildWithName(modTypeID);
@@ -514,13 +712,19 @@ void Nel19AudioProcessor::loadPatch()
                 {
                     const auto type = static_cast<vibrato::ModType>(i);
                     if (typeProp == vibrato::toString(type))
-                        modType[m] = type;
+                        setModType(m, type);
                 }
             }
         }
     }
     for (auto m = 0; m < modulators.size(); ++m)
         modulators[m].loadPatch(modSys.state, m);
+    {
+        const juce::Identifier id(vibrato::toString(vibrato::ObjType::Seed));
+        const auto seedStr = modSys.state.getProperty(id, "").toString();
+        if (seedStr.isNotEmpty())
+            setSeed(static_cast<uint64_t>(seedStr.getHexValue64()));
+    }
     {
         const juce::Identifier id(vibrato::toString(vibrato::ObjType::InterpolationType));
         const auto typeStr = modSys.state.getProperty(id, "").toString();
@@ -4,6 +4,7 @@
 #include "dsp/DryWetProcessor.h"
 #include "dsp/MidSideEncoder.h"
 #include "dsp/Modulator.h"
+#include "dsp/ModsFreeze.h"
 #include "dsp/Vibrato.h"
 #include "oversampling/Oversampling.h"
 #include <JuceHeader.h>
@@ -13,7 +14,7 @@
 struct Nel19AudioProcessor :
     public juce::AudioProcessor
 {
-    static constexpr int NumActiveMods = 2;
+    static constexpr int NumActiveMods = modSys6::NumMods;
 
     Nel19AudioProcessor();
     void prepareToPlay (double sampleRate, int samplesPerBlock) override;
@@ -22,7 +23,10 @@ struct Nel19AudioProcessor :
     bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
    #endif
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlock (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
     void processBlockBypassed(juce::AudioBuffer<float>& buffer, juce::MidiBuffer&) override;
+    void processBlockBypassed(juce::AudioBuffer<double>& buffer, juce::MidiBuffer&) override;
+    bool supportsDoublePrecisionProcessing() const override;
     juce::AudioProcessorEditor* createEditor() override;
     bool hasEditor() const override;
     const juce::String getName() const override;
@@ -38,7 +42,11 @@ struct Nel19AudioProcessor :
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
     void savePatch();
-    void loadPatch();
+    // patch updates from the gui get loaded on the audio thread
+    void loadPatch(bool fromAudioThread = false);
+    void setSeed(uint64_t);
+    // message thread. the slot builds the new engine in the background
+    void setModType(int, vibrato::ModType);
     juce::PropertiesFile::Options makeOptions();
 
     juce::ApplicationProperties appProperties;
@@ -51,9 +59,17 @@ struct Nel19AudioProcessor :
     midSide::Processor midSideProcessor;
     oversampling::Processor oversampling;
     
-    std::array<vibrato::Modulator, NumActiveMods> modulators;
+    vibrato::ModulatorBank modulators;
     std::array<std::vector<float>, 2> modsBuffer;
+    // the mix of all host rate modulators before it gets upsampled into modsBuffer
+    std::array<std::vector<float>, 2> modsBufferLow;
     std::array<vibrato::ModType, NumActiveMods> modType;
+    // the block's midi, decoded once for all modulators
+    vibrato::MidiEvents midiEvents;
+    // the block's transport, read once for all modulators
+    vibrato::Transport transport;
+    // loops a recording of the host rate mix instead of running the modulators
+    freeze::Processor freezer;
     
     vibrato::Processor vibrat;
     
@@ -62,8 +78,25 @@ private:
     const juce::CriticalSection mutex;
     modSys6::Smooth depthSmooth, modsMixSmooth;
     std::vector<float> depthBuf, modsMixBuf;
+    // every slot's weight per sample, pooled. see getModsWeights
+    std::vector<float> modsWeights;
+    vibrato::ControlRateUpsampler modsUpsampler;
+    int modsUpFactor;
+    // seeds all random sources. it's stored in the patch, so that renders are reproducible
+    uint64_t seed;
+    bool wasPlaying;
+    // constant modulation over consecutive blocks lets the vibrato use a static delay
+    bool modsWereConstant, modsStatic;
+    std::array<float, 2> modsConstValues;
 
-    void processBlockVibrato(juce::AudioBuffer<float>&, const juce::MidiBuffer&, int, int);
+    template<typename Float>
+    void processBlockInternal(juce::AudioBuffer<Float>&, juce::MidiBuffer&);
+    template<typename Float>
+    void processBlockBypassedInternal(juce::AudioBuffer<Float>&);
+    template<typename Float>
+    void processBlockVibrato(juce::AudioBuffer<Float>&, const vibrato::MidiEvents&, int, int);
+
+    float* getModsWeights(int m) noexcept { return modsWeights.data() + m * depthBuf.size(); }
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Nel19AudioProcessor)
 };
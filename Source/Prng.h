@@ -0,0 +1,109 @@
+#pragma once
+#include <array>
+#include <cstdint>
+
+namespace prng
+{
+	// seeds the generators' states from a single 64 bit value
+	inline uint64_t splitMix64(uint64_t& x) noexcept
+	{
+		auto z = (x += 0x9e3779b97f4a7c15ull);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+		return z ^ (z >> 31);
+	}
+
+	/*
+	* xoshiro128+ with NumLanes independent states in SoA layout,
+	* so that fill() vectorises over the lanes.
+	* every (seed, stream) pair makes a different, reproducible sequence.
+	*/
+	struct Xoshiro128
+	{
+		static constexpr int NumLanes = 8;
+		using Lanes = std::array<uint32_t, NumLanes>;
+
+		Xoshiro128(uint64_t _seed = 0, uint64_t stream = 0) :
+			state(),
+			cache(),
+			cacheIdx(NumLanes)
+		{
+			seed(_seed, stream);
+		}
+
+		void seed(uint64_t _seed, uint64_t stream) noexcept
+		{
+			uint64_t x = _seed ^ (stream * 0xd1342543de82ef95ull);
+			for (auto l = 0; l < NumLanes; ++l)
+			{
+				const auto a = splitMix64(x);
+				const auto b = splitMix64(x);
+				state[0][l] = static_cast<uint32_t>(a);
+				state[1][l] = static_cast<uint32_t>(a >> 32);
+				state[2][l] = static_cast<uint32_t>(b);
+				state[3][l] = static_cast<uint32_t>(b >> 32) | 1u; // never all zero
+			}
+			cacheIdx = NumLanes;
+		}
+
+		// uniform in [0, 1)
+		float nextFloat() noexcept
+		{
+			if (cacheIdx == NumLanes)
+			{
+				next(cache);
+				cacheIdx = 0;
+			}
+			return toFloat(cache[cacheIdx++]);
+		}
+
+		// uniform in [min, max)
+		void fill(float* dest, int numSamples, float min = 0.f, float max = 1.f) noexcept
+		{
+			const auto range = (max - min) * Scale;
+			Lanes r;
+			auto s = 0;
+			for (; s + NumLanes <= numSamples; s += NumLanes)
+			{
+				next(r);
+				for (auto l = 0; l < NumLanes; ++l)
+					dest[s + l] = min + static_cast<float>(r[l] >> 8) * range;
+			}
+			if (s < numSamples)
+			{
+				next(r);
+				const auto remaining = numSamples - s;
+				for (auto l = 0; l < remaining && l < NumLanes; ++l)
+					dest[s + l] = min + static_cast<float>(r[l] >> 8) * range;
+			}
+		}
+
+	protected:
+		static constexpr float Scale = 1.f / 16777216.f; // 2^-24
+		std::array<Lanes, 4> state;
+		Lanes cache;
+		int cacheIdx;
+
+		static float toFloat(uint32_t x) noexcept { return static_cast<float>(x >> 8) * Scale; }
+		static uint32_t rotl(uint32_t x, int k) noexcept { return (x << k) | (x >> (32 - k)); }
+
+		void next(Lanes& result) noexcept
+		{
+			auto& s0 = state[0];
+			auto& s1 = state[1];
+			auto& s2 = state[2];
+			auto& s3 = state[3];
+			for (auto l = 0; l < NumLanes; ++l)
+			{
+				result[l] = s0[l] + s3[l];
+				const auto t = s1[l] << 9;
+				s2[l] ^= s0[l];
+				s3[l] ^= s1[l];
+				s1[l] ^= s2[l];
+				s0[l] ^= s3[l];
+				s2[l] ^= t;
+				s3[l] = rotl(s3[l], 11);
+			}
+		}
+	};
+}
@@ -0,0 +1,206 @@
+#pragma once
+#include "WavetableImport.h"
+#include <memory>
+#include <map>
+
+// modulation curves (recorded tape wow and flutter, drawn curves..) in a compact binary:
+// a header followed by interleaved 16 bit frames at the curve's own rate.
+// curves can be minutes long, so they never get read into memory. the file is memory mapped
+// and all instances playing the same curve share one mapping, the os pages it in on demand.
+// audio files get converted to a curve next to the source once.
+namespace curveFile
+{
+	static constexpr char Magic[4] = { 'N', 'C', 'V', '1' };
+	static constexpr const char* Extension = ".nelcurve";
+	// sources get averaged down to about this rate, which is plenty for wow and flutter
+	static constexpr double MaxRate = 2000.;
+	static constexpr float FrameToFloat = 1.f / 32767.f;
+
+	struct Header
+	{
+		char magic[4];
+		uint32_t numChannels, numFrames;
+		float sampleRate;
+		uint64_t sourceSize;
+		int64_t sourceModTime;
+		uint64_t hash;
+	};
+
+	inline bool isCurve(const juce::File& file)
+	{
+		return file.hasFileExtension(Extension);
+	}
+
+	inline juce::File getCurveFile(const juce::File& source)
+	{
+		return isCurve(source) ? source : source.getSiblingFile(source.getFileName() + Extension);
+	}
+
+	// a mapped curve file. it's read-only, so any thread can read it
+	struct Curve
+	{
+		Curve(const juce::File& file) :
+			mapped(file, juce::MemoryMappedFile::readOnly),
+			header(),
+			frames(nullptr)
+		{
+			if (mapped.getData() == nullptr || mapped.getSize() < sizeof(Header))
+				return;
+			std::memcpy(&header, mapped.getData(), sizeof(Header));
+			const auto framesSize = static_cast<size_t>(header.numFrames) * header.numChannels * sizeof(int16_t);
+			if (std::memcmp(header.magic, Magic, 4) != 0 ||
+				header.numChannels < 1 || header.numChannels > 2 ||
+				header.numFrames < 4 || !(header.sampleRate > 0.f) ||
+				mapped.getSize() < sizeof(Header) + framesSize)
+				return;
+			frames = reinterpret_cast<const int16_t*>(static_cast<const char*>(mapped.getData()) + sizeof(Header));
+			touchPages(framesSize);
+		}
+
+		bool isValid() const noexcept { return frames != nullptr; }
+		int getNumChannels() const noexcept { return static_cast<int>(header.numChannels); }
+		int getNumFrames() const noexcept { return static_cast<int>(header.numFrames); }
+		float getSampleRate() const noexcept { return header.sampleRate; }
+		uint64_t getHash() const noexcept { return header.hash; }
+
+		// i must be in [0, numFrames)
+		float operator()(int ch, int i) const noexcept
+		{
+			return static_cast<float>(frames[i * header.numChannels + ch]) * FrameToFloat;
+		}
+
+	protected:
+		juce::MemoryMappedFile mapped;
+		Header header;
+		const int16_t* frames;
+
+		// reads one byte of each page, so that the first playback doesn't page fault on the audio thread
+		void touchPages(size_t size) const noexcept
+		{
+			static constexpr size_t PageSize = 4096;
+			const auto bytes = reinterpret_cast<const volatile char*>(frames);
+			char x = 0;
+			for (size_t i = 0; i < size; i += PageSize)
+				x ^= bytes[i];
+			juce::ignoreUnused(x);
+		}
+	};
+
+	// averages all channels of the source down to at most MaxRate and writes them as a curve file.
+	// the source is read in chunks, only the (small) decimated curve is kept in memory
+	inline bool convert(const juce::File& source, const juce::File& dest, uint64_t& hash)
+	{
+		{
+			juce::MemoryMappedFile mapped(source, juce::MemoryMappedFile::readOnly);
+			if (mapped.getData() == nullptr || mapped.getSize() == 0)
+				return false;
+			hash = wtImport::makeHash(mapped.getData(), mapped.getSize());
+		}
+
+		juce::AudioFormatManager manager;
+		manager.registerBasicFormats();
+		std::unique_ptr<juce::AudioFormatReader> reader(manager.createReaderFor(source));
+		if (reader == nullptr || reader->lengthInSamples == 0 || reader->sampleRate <= 0.)
+			return false;
+
+		const auto numChannels = std::min(static_cast<int>(reader->numChannels), 2);
+		const auto decimation = std::max(1, static_cast<int>(std::ceil(reader->sampleRate / MaxRate)));
+		const auto decimationInv = 1.f / static_cast<float>(decimation);
+		const auto numFrames = static_cast<int>(reader->lengthInSamples / decimation);
+		if (numFrames < 4)
+			return false;
+
+		std::vector<float> curve;
+		curve.resize(static_cast<size_t>(numFrames) * numChannels);
+		{ // DECIMATE IN CHUNKS
+			static constexpr int ChunkFrames = 1 << 10;
+			juce::AudioBuffer<float> chunk(numChannels, ChunkFrames * decimation);
+			for (auto f0 = 0; f0 < numFrames; f0 += ChunkFrames)
+			{
+				const auto chunkFrames = std::min(ChunkFrames, numFrames - f0);
+				reader->read(&chunk, 0, chunkFrames * decimation, static_cast<juce::int64>(f0) * decimation, true, numChannels == 2);
+				for (auto ch = 0; ch < numChannels; ++ch)
+				{
+					const auto smpls = chunk.getReadPointer(ch);
+					for (auto f = 0; f < chunkFrames; ++f)
+					{
+						auto sum = 0.f;
+						for (auto d = 0; d < decimation; ++d)
+							sum += smpls[f * decimation + d];
+						curve[(f0 + f) * numChannels + ch] = sum * decimationInv;
+					}
+				}
+			}
+		}
+
+		const auto range = juce::FloatVectorOperations::findMinAndMax(curve.data(), static_cast<int>(curve.size()));
+		const auto peak = std::max(std::abs(range.getStart()), std::abs(range.getEnd()));
+		const auto gain = peak == 0.f ? 0.f : 32767.f / peak;
+		std::vector<int16_t> frames;
+		frames.resize(curve.size());
+		for (size_t i = 0; i < curve.size(); ++i)
+			frames[i] = static_cast<int16_t>(std::round(juce::jlimit(-32767.f, 32767.f, curve[i] * gain)));
+
+		Header header;
+		std::memcpy(header.magic, Magic, 4);
+		header.numChannels = static_cast<uint32_t>(numChannels);
+		header.numFrames = static_cast<uint32_t>(numFrames);
+		header.sampleRate = static_cast<float>(reader->sampleRate / static_cast<double>(decimation));
+		header.sourceSize = static_cast<uint64_t>(source.getSize());
+		header.sourceModTime = source.getLastModificationTime().toMilliseconds();
+		header.hash = hash;
+
+		juce::MemoryBlock block;
+		block.append(&header, sizeof(Header));
+		block.append(frames.data(), frames.size() * sizeof(int16_t));
+		return dest.replaceWithData(block.getData(), block.getSize());
+	}
+
+	// the curve file is valid if it belongs to the source as it is now, or, if the source is gone,
+	// if it carries the expected hash (0 accepts any). curve files picked directly are always valid
+	inline bool isUpToDate(const juce::File& source, const juce::File& curveFile, uint64_t expectedHash)
+	{
+		if (!curveFile.existsAsFile())
+			return false;
+		juce::FileInputStream stream(curveFile);
+		Header header;
+		if (stream.read(&header, sizeof(Header)) != sizeof(Header) || std::memcmp(header.magic, Magic, 4) != 0)
+			return false;
+		if (isCurve(source))
+			return true;
+		if (source.existsAsFile())
+			return header.sourceSize == static_cast<uint64_t>(source.getSize()) &&
+				header.sourceModTime == source.getLastModificationTime().toMilliseconds();
+		return expectedHash == 0 || expectedHash == header.hash;
+	}
+
+	// not realtime-safe, meant for a worker thread.
+	// instances loading the same curve share its mapping as long as any of them uses it
+	inline std::shared_ptr<Curve> load(const juce::File& source, uint64_t expectedHash)
+	{
+		static juce::CriticalSection mutex;
+		static std::map<juce::String, std::weak_ptr<Curve>> sharedCurves;
+
+		const juce::ScopedLock lock(mutex);
+		const auto file = getCurveFile(source);
+		auto converted = false;
+		if (!isUpToDate(source, file, expectedHash))
+		{
+			uint64_t hash = 0;
+			if (!source.existsAsFile() || !convert(source, file, hash))
+				return nullptr;
+			converted = true;
+		}
+
+		const auto path = file.getFullPathName();
+		auto curve = sharedCurves[path].lock();
+		if (curve == nullptr || converted)
+		{
+			curve = std::make_shared<Curve>(file);
+			if (!curve->isValid())
+				return nullptr;
+			sharedCurves[path] = curve;
+		}
+		return curve;
+	}
+}
@@ -1,10 +1,12 @@
 #pragma once
 #include "../modsys/ModSys.h"
+#include <type_traits>
 
 namespace drywet
 {
 	inline juce::String getLookaheadID() { return "lookaheadEnabled"; }
 
+	template<typename Float>
 	struct FFDelay
 	{
 		FFDelay() :
@@ -13,11 +15,11 @@ namespace drywet
 		{}
 		void resize(const int size)
 		{
-			ringBuffer.resize(size, 0.f);
+			ringBuffer.resize(size, static_cast<Float>(0));
 			wHead = 0;
 			rHead = 1;
 		}
-		void processBlock(float* dry, const int numSamples) noexcept
+		void processBlock(Float* dry, const int numSamples) noexcept
 		{
 			for (auto s = 0; s < numSamples; ++s)
 			{
@@ -31,7 +33,7 @@ namespace drywet
 					rHead = 0;
 			}
 		}
-		void processBlock(float* dest, const float* src, const int numSamples) noexcept
+		void processBlock(Float* dest, const Float* src, const int numSamples) noexcept
 		{
 			for (auto s = 0; s < numSamples; ++s)
 			{
@@ -46,17 +48,21 @@ namespace drywet
 			}
 		}
 	protected:
-		std::vector<float> ringBuffer;
+		std::vector<Float> ringBuffer;
 		size_t wHead, rHead;
 	};
 
 	struct Processor
 	{
-		using Buffer = std::array<std::vector<float>, 3>;
+		template<typename Float>
+		using BufferT = std::array<std::vector<Float>, 3>;
+		using Buffer = BufferT<float>;
+		template<typename Float>
+		using DryDelay = std::array<FFDelay<Float>, 2>;
 
 		Processor(int _numChannels) :
 			mixSmooth(false),
-			dryBuffer(), paramBuffer(),
+			dryBuffer(), dryBufferD(), paramBuffer(),
 			numChannels(_numChannels),
 			
 			gainWet(420.f), gainWetVal(1.f),
@@ -70,18 +76,27 @@ namespace drywet
 		{
 			lookaheadEnabled.store(e);
 		}
-		void prepare(float sampleRate, int maxBufferSize, int latency)
+		// only the dry buffers of the used sample type get memory
+		void prepare(float sampleRate, int maxBufferSize, int latency, bool doublePrecision)
 		{
 			modSys6::Smooth::makeFromDecayInMs(mixSmooth, 10.f, sampleRate);
 			modSys6::Smooth::makeFromDecayInMs(gainWetSmooth, 4.f, sampleRate);
+			const auto sizeF = doublePrecision ? 0 : maxBufferSize;
+			const auto sizeD = doublePrecision ? maxBufferSize : 0;
 			for (auto& b : dryBuffer)
-				b.resize(maxBufferSize, 0.f);
+				b.resize(sizeF, 0.f);
+			for (auto& b : dryBufferD)
+				b.resize(sizeD, 0.);
 			for (auto& b : paramBuffer)
 				b.resize(maxBufferSize, 0.f);
 			for (auto ch = 0; ch < numChannels; ++ch)
-				dryDelay[ch].resize(latency);
+			{
+				dryDelay[ch].resize(doublePrecision ? 0 : latency);
+				dryDelayD[ch].resize(doublePrecision ? latency : 0);
+			}
 		}
-		bool processBypass(float** samples, int numChannelsIn, int numChannelsOut, int numSamples) noexcept
+		template<typename Float>
+		bool processBypass(Float** samples, int numChannelsIn, int numChannelsOut, int numSamples) noexcept
 		{
 			{ // CHECK IF LOOKAHEAD STATE CHANGED
 				const auto e = lookaheadEnabled.load();
@@ -93,9 +108,11 @@ namespace drywet
 			}
 			if (lookaheadState)
 			{
+				auto& dryDly = getDryDelay<Float>();
+				auto& dryBuf = getDryBuffer<Float>();
 				{
-					auto& dly = dryDelay[0];
-					auto dry = dryBuffer[0].data();
+					auto& dly = dryDly[0];
+					auto dry = dryBuf[0].data();
 					auto smpls = samples[0];
 
 					dly.processBlock(dry, smpls, numSamples);
@@ -107,8 +124,8 @@ namespace drywet
 						juce::FloatVectorOperations::copy(samples[1], samples[0], numSamples);
 					else
 					{
-						auto& dly = dryDelay[1];
-						auto dry = dryBuffer[1].data();
+						auto& dly = dryDly[1];
+						auto dry = dryBuf[1].data();
 						auto smpls = samples[1];
 
 						dly.processBlock(dry, smpls, numSamples);
@@ -119,7 +136,8 @@ namespace drywet
 			}
 			return true;
 		}
-		bool saveDry(const float** samples, float mixVal, int numChannelsIn, int numChannelsOut, int numSamples) noexcept
+		template<typename Float>
+		bool saveDry(const Float** samples, float mixVal, int numChannelsIn, int numChannelsOut, int numSamples) noexcept
 		{
 			{ // CHECK IF LOOKAHEAD STATE CHANGED
 				const auto e = lookaheadEnabled.load();
@@ -141,19 +159,21 @@ namespace drywet
 					paramBuffer[1][s] = std::sqrt(mixBuf[s]);
 			}
 			{ // SAVE DRY BUFFER
+				auto& dryBuf = getDryBuffer<Float>();
 				if (lookaheadState)
 				{
+					auto& dryDly = getDryDelay<Float>();
 					{
-						auto& dly = dryDelay[0];
-						auto dry = dryBuffer[0].data();
+						auto& dly = dryDly[0];
+						auto dry = dryBuf[0].data();
 						auto smpls = samples[0];
 
 						dly.processBlock(dry, smpls, numSamples);
 					}
 					if (numChannelsOut == 2 && numChannelsIn == numChannels)
 					{
-						auto& dly = dryDelay[1];
-						auto dry = dryBuffer[1].data();
+						auto& dly = dryDly[1];
+						auto dry = dryBuf[1].data();
 						auto smpls = samples[1];
 
 						dly.processBlock(dry, smpls, numSamples);
@@ -163,7 +183,7 @@ namespace drywet
 				{
 					for (auto ch = 0; ch < numChannelsIn; ++ch)
 					{
-						auto dry = dryBuffer[ch].data();
+						auto dry = dryBuf[ch].data();
 						const auto smpls = samples[ch];
 
 						juce::FloatVectorOperations::copy(dry, smpls, numSamples);
@@ -172,7 +192,8 @@ namespace drywet
 			}
 			return true;
 		}
-		void processWet(float** samples, float _gainWet, int numChannelsIn, int numChannelsOut, int numSamples) noexcept
+		template<typename Float>
+		void processWet(Float** samples, float _gainWet, int numChannelsIn, int numChannelsOut, int numSamples) noexcept
 		{
 			if (gainWet != _gainWet)
 			{
@@ -186,9 +207,10 @@ namespace drywet
 			}
 			const auto pBuf0 = paramBuffer[0].data();
 			const auto pBuf1 = paramBuffer[1].data();
+			auto& dryBuf = getDryBuffer<Float>();
 			{
 				auto smpls = samples[0];
-				const auto dry = dryBuffer[0].data();
+				const auto dry = dryBuf[0].data();
 
 				for (auto s = 0; s < numSamples; ++s)
 					smpls[s] = dry[s] * pBuf0[s] + smpls[s] * pBuf1[s] * gainBuf[s];
@@ -197,7 +219,7 @@ namespace drywet
 			if (numChannelsOut == 2)
 			{
 				auto smpls = samples[1];
-				const auto dry = dryBuffer[1 % numChannelsIn].data();
+				const auto dry = dryBuf[1 % numChannelsIn].data();
 
 				for (auto s = 0; s < numSamples; ++s)
 					smpls[s] = dry[s] * pBuf0[s] + smpls[s] * pBuf1[s] * gainBuf[s];
@@ -206,8 +228,11 @@ namespace drywet
 		bool isLookaheadEnabled() const noexcept { return lookaheadEnabled.load(); }
 	protected:
 		modSys6::Smooth mixSmooth;
-		std::array<FFDelay, 2> dryDelay;
-		Buffer dryBuffer, paramBuffer;
+		DryDelay<float> dryDelay;
+		DryDelay<double> dryDelayD;
+		Buffer dryBuffer;
+		BufferT<double> dryBufferD;
+		Buffer paramBuffer;
 		const int numChannels;
 
 		float gainWet, gainWetVal;
@@ -215,6 +240,23 @@ namespace drywet
 
 		std::atomic<bool> lookaheadEnabled;
 		bool lookaheadState;
+
+		template<typename Float>
+		DryDelay<Float>& getDryDelay() noexcept
+		{
+			if constexpr (std::is_same<Float, double>::value)
+				return dryDelayD;
+			else
+				return dryDelay;
+		}
+		template<typename Float>
+		BufferT<Float>& getDryBuffer() noexcept
+		{
+			if constexpr (std::is_same<Float, double>::value)
+				return dryBufferD;
+			else
+				return dryBuffer;
+		}
 	};
 }
 
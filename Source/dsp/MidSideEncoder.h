@@ -8,17 +8,20 @@ namespace midSide
 			enabled(numChannels == 2)
 		{}
 		void setEnabled(bool e) { enabled = e; }
-		void processBlockEncode(float** samples, int numSamples) noexcept
+		template<typename Float>
+		void processBlockEncode(Float** samples, int numSamples) noexcept
 		{
+			static constexpr Float Half = static_cast<Float>(.5);
 			for (auto s = 0; s < numSamples; ++s)
 			{
-				const auto mid = (samples[0][s] + samples[1][s]) * .5f;
-				const auto side = (samples[0][s] - samples[1][s]) * .5f;
+				const auto mid = (samples[0][s] + samples[1][s]) * Half;
+				const auto side = (samples[0][s] - samples[1][s]) * Half;
 				samples[0][s] = mid;
 				samples[1][s] = side;
 			}
 		}
-		void processBlockDecode(float** samples, int numSamples) noexcept
+		template<typename Float>
+		void processBlockDecode(Float** samples, int numSamples) noexcept
 		{
 			for (auto s = 0; s < numSamples; ++s)
 			{
@@ -0,0 +1,233 @@
+#pragma once
+#include "Modulator.h"
+
+// records the mix of the host rate modulators for some bars and loops it from then on, so
+// that a modulation one likes can be kept and they don't have to run while it plays back.
+// high rate modulators (audiorate) stay live and get added on top.
+// synced to a playing host the recording starts on a bar line (4/4 assumed) and the
+// playback follows the playhead, otherwise it just loops freely.
+// the recording runs a bit longer than the loop and that tail gets crossfaded into the
+// loop's start, so the loop point doesn't click
+namespace freeze
+{
+	// the loop gets shortened by whole bars to fit, then cut
+	static constexpr double MaxLengthSeconds = 16.;
+	static constexpr float FadeMs = 20.f;
+
+	struct Processor
+	{
+		enum class State { Off, Waiting, Recording, Frozen, Releasing };
+
+		Processor() :
+			loop(),
+			fs(1.), extLatency(0.),
+			capacity(0), fadeLength(1),
+			state(State::Off),
+			synced(false),
+			loopLength(1), recIdx(0), startOffset(0), fadeIdx(0),
+			playPos(0.), ppqStart(0.), loopBeats(4.), bpmRec(120.)
+		{}
+
+		// the loop gets its memory here, so that freezing never allocates on the audio thread
+		void prepare(float sampleRate, int latency)
+		{
+			fs = static_cast<double>(sampleRate);
+			extLatency = static_cast<double>(latency);
+			fadeLength = std::max(1, static_cast<int>(sampleRate * FadeMs * .001f));
+			capacity = static_cast<int>(fs * MaxLengthSeconds) + fadeLength;
+			for (auto& l : loop)
+				l.resize(capacity, 0.f);
+			state = State::Off;
+		}
+		// the modulators can sleep
+		bool isFrozen() const noexcept { return state == State::Frozen; }
+		// the modulation can't be treated as constant
+		bool isActive() const noexcept { return state != State::Off; }
+
+		// call once per block before the modulators. the number of bars only gets read when the recording starts
+		void update(bool enabled, int numBars, const vibrato::Transport& transport, int numSamples) noexcept
+		{
+			if (!enabled)
+			{
+				if (state == State::Frozen)
+				{
+					state = State::Releasing;
+					fadeIdx = 0;
+				}
+				else if (state != State::Releasing)
+					state = State::Off;
+				return;
+			}
+			if (state == State::Releasing)
+				state = State::Frozen;
+			else if (state == State::Off)
+				startRecording(numBars, transport);
+			if (state == State::Waiting)
+				waitForBar(transport, numSamples);
+		}
+
+		// replaces the mix of the modulators while frozen
+		void processBlockFrozen(float* const* mods, int numChannels, int numSamples, const vibrato::Transport& transport) noexcept
+		{
+			const auto inc = syncPosition(transport);
+			for (auto ch = 0; ch < numChannels; ++ch)
+			{
+				auto pos = playPos;
+				for (auto s = 0; s < numSamples; ++s)
+				{
+					mods[ch][s] = read(ch, pos);
+					pos = wrap(pos + inc);
+				}
+			}
+			playPos = wrap(playPos + inc * static_cast<double>(numSamples));
+		}
+
+		// records the mix of the modulators, or fades from the loop back to them after unfreezing
+		void processBlock(float* const* mods, int numChannels, int numSamples, const vibrato::Transport& transport) noexcept
+		{
+			if (state == State::Recording)
+				record(mods, numChannels, numSamples);
+			else if (state == State::Releasing)
+				release(mods, numChannels, numSamples, transport);
+		}
+
+	protected:
+		std::array<std::vector<float>, 2> loop;
+		double fs, extLatency;
+		int capacity, fadeLength;
+		State state;
+		bool synced;
+		int loopLength, recIdx, startOffset, fadeIdx;
+		double playPos, ppqStart, loopBeats, bpmRec;
+
+		double getPpq(const vibrato::Transport& transport) const noexcept
+		{
+			return transport.ppq - extLatency * transport.bpm / (60. * fs);
+		}
+
+		void startRecording(int numBars, const vibrato::Transport& transport) noexcept
+		{
+			synced = transport.hasPlayHead && transport.isPlaying;
+			bpmRec = transport.bpm;
+			const auto barLength = 4. * 60. * fs / bpmRec;
+			const auto maxLength = static_cast<double>(capacity - fadeLength);
+			auto bars = std::max(1, numBars);
+			while (bars > 1 && bars * barLength > maxLength)
+				bars >>= 1;
+			loopLength = std::max(fadeLength + 1, static_cast<int>(std::min(std::rint(bars * barLength), maxLength)));
+			loopBeats = static_cast<double>(loopLength) * bpmRec / (60. * fs);
+			recIdx = 0;
+			startOffset = 0;
+			state = synced ? State::Waiting : State::Recording;
+		}
+
+		void waitForBar(const vibrato::Transport& transport, int numSamples) noexcept
+		{
+			if (!transport.isPlaying)
+			{
+				synced = false;
+				state = State::Recording;
+				return;
+			}
+			const auto ppq = getPpq(transport);
+			const auto nextBar = std::ceil(ppq * .25) * 4.;
+			const auto samplesToBar = (nextBar - ppq) * 60. * fs / transport.bpm;
+			if (samplesToBar >= static_cast<double>(numSamples))
+				return;
+			startOffset = static_cast<int>(samplesToBar);
+			ppqStart = nextBar;
+			state = State::Recording;
+		}
+
+		void record(float* const* mods, int numChannels, int numSamples) noexcept
+		{
+			const auto length = loopLength + fadeLength;
+			const auto n = std::min(numSamples - startOffset, length - recIdx);
+			const auto fadeInc = 1.f / static_cast<float>(fadeLength);
+			for (auto ch = 0; ch < numChannels; ++ch)
+			{
+				auto l = loop[ch].data();
+				auto m = mods[ch] + startOffset;
+				juce::FloatVectorOperations::copy(l + recIdx, m, n);
+				// the tail fades into the loop's start. it's played while it's recorded,
+				// so that the mix arrives in the loop without a jump
+				for (auto s = std::max(0, loopLength - recIdx); s < n; ++s)
+				{
+					const auto i = recIdx + s - loopLength;
+					const auto w = static_cast<float>(i) * fadeInc;
+					l[i] = l[loopLength + i] + w * (l[i] - l[loopLength + i]);
+					m[s] = l[i];
+				}
+			}
+			const auto s0 = startOffset + n;
+			startOffset = 0;
+			recIdx += n;
+			if (recIdx != length)
+				return;
+
+			state = State::Frozen;
+			playPos = static_cast<double>(fadeLength);
+			for (auto ch = 0; ch < numChannels; ++ch)
+			{
+				auto pos = playPos;
+				for (auto s = s0; s < numSamples; ++s)
+				{
+					mods[ch][s] = read(ch, pos);
+					pos = wrap(pos + 1.);
+				}
+			}
+			playPos = wrap(playPos + static_cast<double>(numSamples - s0));
+		}
+
+		void release(float* const* mods, int numChannels, int numSamples, const vibrato::Transport& transport) noexcept
+		{
+			const auto inc = syncPosition(transport);
+			const auto fadeInc = 1.f / static_cast<float>(fadeLength);
+			const auto n = std::min(numSamples, fadeLength - fadeIdx);
+			for (auto ch = 0; ch < numChannels; ++ch)
+			{
+				auto pos = playPos;
+				for (auto s = 0; s < n; ++s)
+				{
+					const auto frozen = read(ch, pos);
+					const auto w = static_cast<float>(fadeIdx + s) * fadeInc;
+					mods[ch][s] = frozen + w * (mods[ch][s] - frozen);
+					pos = wrap(pos + inc);
+				}
+			}
+			playPos = wrap(playPos + inc * static_cast<double>(numSamples));
+			fadeIdx += n;
+			if (fadeIdx == fadeLength)
+				state = State::Off;
+		}
+
+		// returns the playback speed. synced loops jump to where the playhead is, in case it moved
+		double syncPosition(const vibrato::Transport& transport) noexcept
+		{
+			if (!synced || !transport.isPlaying)
+				return 1.;
+			auto beats = std::fmod(getPpq(transport) - ppqStart, loopBeats);
+			if (beats < 0.)
+				beats += loopBeats;
+			playPos = wrap(beats / loopBeats * static_cast<double>(loopLength));
+			return transport.bpm / bpmRec;
+		}
+
+		double wrap(double pos) const noexcept
+		{
+			const auto length = static_cast<double>(loopLength);
+			while (pos >= length)
+				pos -= length;
+			return pos;
+		}
+
+		float read(int ch, double pos) const noexcept
+		{
+			const auto i = static_cast<int>(pos);
+			const auto frac = static_cast<float>(pos - static_cast<double>(i));
+			const auto i1 = i + 1 == loopLength ? 0 : i + 1;
+			const auto l = loop[ch].data();
+			return l[i] + frac * (l[i1] - l[i]);
+		}
+	};
+}
@@ -13,26 +13,35 @@ namespace modSys6
             public Comp
         {
             using Tables = vibrato::Wavetable3D<WTSize, NumTables>;
+            using Builder = vibrato::TablesBuilder<Tables>;
 
-            WavetableView(Utils& u, juce::String&& _tooltip, const Tables& _tables) :
+            WavetableView(Utils& u, juce::String&& _tooltip, Builder& _builder) :
                 Comp(u, std::move(_tooltip), CursorType::Default),
-                tables(_tables),
+                builder(_builder),
+                tables(builder.load()),
                 tablesPhase(0.f)
             {}
+            // also repaints once the builder published new tables
             void update(float _tablesPhase)
             {
-                if (tablesPhase != _tablesPhase)
+                auto _tables = builder.load();
+                if (tablesPhase != _tablesPhase || tables != _tables)
                 {
                     tablesPhase = _tablesPhase;
+                    tables = _tables;
                     repaint();
                 }
             }
         protected:
-            const Tables& tables;
+            Builder& builder;
+            std::shared_ptr<Tables> tables;
             float tablesPhase;
 
             void paint(juce::Graphics& g) override
             {
+                // the tables only get built once the lfo is selected
+                if (tables == nullptr)
+                    return;
                 const auto thicc = Shared::shared.thicc;
                 const auto bounds = getLocalBounds().toFloat().reduced(thicc);
                 const auto rad = bounds.getHeight() * .5f;
@@ -49,7 +58,7 @@ namespace modSys6
                     auto tablePhase = iX * NumWaveCyclesF;
                     while (tablePhase >= 1.f)
                         --tablePhase;
-                    const auto smpl = tables(tablesPhase, tablePhase) * -1.f;
+                    const auto smpl = (*tables)(tablesPhase, tablePhase) * -1.f;
                     const auto col = juce::Colours::transparentBlack
                         .interpolatedWith(Shared::shared.colour(ColourID::Mod), window);
                     g.setColour(col);
@@ -356,7 +365,7 @@ namespace modSys6
         {
             enum { Attack, Release, Gain, Width, NumParams };
 
-            ModCompEnvFol(Utils& u, std::vector<Paramtr*>& modulatables, int mOff = 0) :
+            ModCompEnvFol(Utils& u, std::vector<Paramtr*>& modulatables, vibrato::EnvFolSettings& _settings, int mOff = 0) :
                 Comp(u, "", CursorType::Default),
                 layout(
                     { 50, 50, 50, 50, 30 },
@@ -367,22 +376,60 @@ namespace modSys6
                     Paramtr(u, "Release", "The envelope follower's release time in milliseconds.", withOffset(PID::EnvFol0Release, mOff), modulatables),
                     Paramtr(u, "Gain", "This modulator's input gain.", withOffset(PID::EnvFol0Gain, mOff), modulatables),
                     Paramtr(u, "Width", "The modulator's stereo-width", withOffset(PID::EnvFol0Width, mOff), modulatables)
-            }
+                },
+                settings(_settings),
+                modeButton(u, "Switch between peak, rms and true-peak detection."),
+                lookaheadButton(u, "Lookahead lets the envelope lead the audio by the vibrato's latency."),
+                sidechainButton(u, "Follow the sidechain input instead of the main input, if it's connected.")
             {
                 for (auto& p : params)
                 {
                     addAndMakeVisible(p);
                 }
+                addAndMakeVisible(modeButton);
+                addAndMakeVisible(lookaheadButton);
+                addAndMakeVisible(sidechainButton);
+                modeButton.onClick = [this]()
+                {
+                    const auto numModes = static_cast<int>(vibrato::EnvFolMode::NumModes);
+                    const auto mode = (static_cast<int>(settings.mode.load()) + 1) % numModes;
+                    settings.mode.store(static_cast<vibrato::EnvFolMode>(mode));
+                    updateButtons();
+                };
+                lookaheadButton.onClick = [this]()
+                {
+                    settings.lookahead.store(!settings.lookahead.load());
+                    updateButtons();
+                };
+                sidechainButton.onClick = [this]()
+                {
+                    settings.sidechain.store(!settings.sidechain.load());
+                    updateButtons();
+                };
+                updateButtons();
             }
             void activate(ParamtrRandomizer& randomizer)
             {
                 for (auto& p : params)
                     randomizer.add(&p);
+                updateButtons();
                 setVisible(true);
             }
         protected:
             nelG::Layout layout;
             std::array<Paramtr, NumParams> params;
+            vibrato::EnvFolSettings& settings;
+            Button modeButton, lookaheadButton, sidechainButton;
+
+            void updateButtons()
+            {
+                modeButton.onPaint = makeTextButtonOnPaint(vibrato::toString(settings.mode.load()));
+                lookaheadButton.onPaint = makeTextButtonOnPaint(settings.lookahead.load() ? "Lookahead" : "In Time");
+                sidechainButton.onPaint = makeTextButtonOnPaint(settings.sidechain.load() ? "SC" : "In");
+                modeButton.repaint();
+                lookaheadButton.repaint();
+                sidechainButton.repaint();
+            }
 
             void mouseEnter(const juce::MouseEvent& evt) override
             {
@@ -400,6 +447,9 @@ namespace modSys6
                 layout.place(params[Attack], 1, 0, 1, 2, 0.f, true);
                 layout.place(params[Release],2, 0, 1, 2, 0.f, true);
                 layout.place(params[Width],  3, 1, 1, 1, 0.f, true);
+                layout.place(modeButton,     0, 0, 1, 1, 0.f, true);
+                layout.place(lookaheadButton,3, 0, 1, 1, 0.f, true);
+                layout.place(sidechainButton,4, 0, 1, 1, 0.f, true);
             }
         };
 
@@ -481,7 +531,7 @@ namespace modSys6
 
             enum { IsSync, RateFree, RateSync, Waveform, Phase, Width, NumParams };
 
-            ModCompLFO(Utils& u, std::vector<Paramtr*>& modulatables, vibrato::LFOTables& _tables, int mOff = 0) :
+            ModCompLFO(Utils& u, std::vector<Paramtr*>& modulatables, vibrato::LFOTablesBuilder& _tables, int mOff = 0) :
                 Comp(u, "", CursorType::Default),
                 layout(
                     { 50, 50, 50, 50, 50 },
@@ -501,6 +551,7 @@ namespace modSys6
                 tableView(u, "Here you can admire this LFO's current waveform.", tables),
                 wavetableBrowser(u),
                 browserButton(u, "Click here to explore the wavetable browser."),
+                fileChooser(),
                 isSync(-1)
             {
                 addAndMakeVisible(tableView);
@@ -522,16 +573,15 @@ namespace modSys6
             {
                 for (auto& p : params)
                     randomizer.add(&p);
-                randomizer.add([this](juce::Random& rand)
+                randomizer.add([this](prng::Xoshiro128& rand)
                     {
                         auto val = static_cast<int>(std::floor(rand.nextFloat() * 3.f));
                         switch (val)
                         {
-                        case 0: tables.makeTablesSinc(); break;
-                        case 1: tables.makeTablesTriangles(); break;
-                        case 2: tables.makeTablesWeierstrasz(); break;
+                        case 0: tables.requestTables(vibrato::TableType::Sinc); break;
+                        case 1: tables.requestTables(vibrato::TableType::Tri); break;
+                        case 2: tables.requestTables(vibrato::TableType::Weierstrasz); break;
                         }
-                        tableView.repaint();
                     }
                 );
                 setVisible(true);
@@ -541,10 +591,11 @@ namespace modSys6
             nelG::Layout layout;
             std::array<Paramtr, NumParams> params;
             const Param& lfoWaveformParam;
-            vibrato::LFOTables& tables;
+            vibrato::LFOTablesBuilder& tables;
             WTView tableView;
             Browser wavetableBrowser;
             Button browserButton;
+            std::unique_ptr<juce::FileChooser> fileChooser;
             int isSync;
 
             void mouseEnter(const juce::MouseEvent& evt) override
@@ -619,8 +670,7 @@ namespace modSys6
                     "Modulate the vibrato with mesmerizing weierstrasz sinusoids.",
                     [this]()
                     {
-                        tables.makeTablesWeierstrasz();
-                        tableView.repaint();
+                        tables.requestTables(vibrato::TableType::Weierstrasz);
                         wavetableBrowser.setVisible(false);
                     }
                 );
@@ -629,8 +679,7 @@ namespace modSys6
                     "Resample the signal with rich triangular textures.",
                     [this]()
                     {
-                        tables.makeTablesTriangles();
-                        tableView.repaint();
+                        tables.requestTables(vibrato::TableType::Tri);
                         wavetableBrowser.setVisible(false);
                     }
                 );
@@ -639,11 +688,150 @@ namespace modSys6
                     "Everyone loves a good sinc function.",
                     [this]()
                     {
-                        tables.makeTablesSinc();
-                        tableView.repaint();
+                        tables.requestTables(vibrato::TableType::Sinc);
                         wavetableBrowser.setVisible(false);
                     }
                 );
+                wavetableBrowser.addEntry(
+                    "Import..",
+                    "Load your own wavetable from a wav or raw float file.",
+                    [this]()
+                    {
+                        wavetableBrowser.setVisible(false);
+                        fileChooser = std::make_unique<juce::FileChooser>(
+                            "Import Wavetable",
+                            tables.getUserFile(),
+                            "*.wav;*.aif;*.aiff;*.raw;*.f32"
+                        );
+                        fileChooser->launchAsync(
+                            juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles,
+                            [this](const juce::FileChooser& chooser)
+                            {
+                                const auto file = chooser.getResult();
+                                if (file.existsAsFile())
+                                    tables.requestUserTables(file);
+                            }
+                        );
+                    }
+                );
+            }
+        };
+
+        struct ModCompCurve :
+            public Comp,
+            public juce::Timer
+        {
+            enum { IsSync, Speed, RateSync, Width, NumParams };
+
+            ModCompCurve(Utils& u, std::vector<Paramtr*>& modulatables, vibrato::CurveLoader& _loader, int mOff = 0) :
+                Comp(u, "", CursorType::Default),
+                layout(
+                    { 50, 50, 50, 50, 50 },
+                    { 80, 40 }
+                ),
+                params
+                {
+                    Paramtr(u, "sync", "Switch between free running and temposynced curve playback.", withCurveOffset(PID::Curve0FreeSync, mOff), modulatables, ParameterType::Switch),
+                    Paramtr(u, "Speed", "Play the curve faster or slower than it was recorded.", withCurveOffset(PID::Curve0Speed, mOff), modulatables),
+                    Paramtr(u, "Rate", "Stretch the whole curve over this many beats.", withCurveOffset(PID::Curve0RateSync, mOff), modulatables),
+                    Paramtr(u, "Width", "Offset the right/side channel's position in the curve.", withCurveOffset(PID::Curve0Width, mOff), modulatables)
+                },
+                loader(_loader),
+                loadButton(u, "Load a modulation curve, like recorded tape wow and flutter, from an audio or curve file."),
+                fileLabel(u, ""),
+                fileChooser(),
+                isSync(-1)
+            {
+                for (auto& p : params)
+                    addChildComponent(p);
+                params[Width].setVisible(true);
+                addAndMakeVisible(loadButton);
+                addAndMakeVisible(fileLabel);
+                loadButton.onPaint = makeTextButtonOnPaint("Load..");
+                loadButton.onClick = [this]()
+                {
+                    fileChooser = std::make_unique<juce::FileChooser>(
+                        "Load Curve",
+                        loader.getFile(),
+                        "*.nelcurve;*.wav;*.aif;*.aiff;*.flac"
+                    );
+                    fileChooser->launchAsync(
+                        juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles,
+                        [this](const juce::FileChooser& chooser)
+                        {
+                            const auto file = chooser.getResult();
+                            if (file.existsAsFile())
+                                loader.requestCurve(file);
+                        }
+                    );
+                };
+                startTimerHz(4);
+            }
+            void activate(ParamtrRandomizer& randomizer)
+            {
+                for (auto& p : params)
+                    randomizer.add(&p);
+                setVisible(true);
+            }
+        protected:
+            nelG::Layout layout;
+            std::array<Paramtr, NumParams> params;
+            vibrato::CurveLoader& loader;
+            Button loadButton;
+            Label fileLabel;
+            std::unique_ptr<juce::FileChooser> fileChooser;
+            int isSync;
+
+            void mouseEnter(const juce::MouseEvent& evt) override
+            {
+                Comp::mouseEnter(evt);
+            }
+
+            void paint(juce::Graphics&) override
+            {
+            }
+
+            void resized() override
+            {
+                layout.setBounds(getLocalBounds().toFloat());
+                layout.place(params[IsSync],    0, 1, 1, 1, 0.f, true);
+                layout.place(params[Speed],     0, 0, 1, 1, 0.f, true);
+                layout.place(params[RateSync],  0, 0, 1, 1, 0.f, true);
+                layout.place(params[Width],     1, 0, 1, 1, 0.f, true);
+                layout.place(loadButton,        1, 1, 1, 1, 0.f, true);
+                layout.place(fileLabel,         2, 0, 3, 2, 0.f, true);
+            }
+
+            void timerCallback() override
+            {
+                const auto name = loader.getFile().getFileNameWithoutExtension();
+                if (fileLabel.getText() != name)
+                {
+                    fileLabel.setText(name);
+                    fileLabel.repaint();
+                }
+
+                if (this->utils.hasPlayHead())
+                {
+                    params[IsSync].setVisible(true);
+                    const auto isSyncParam = this->utils.getParam(params[IsSync].getPID());
+                    const auto _isSync = isSyncParam->getValueSum() < .5f ? 0 : 1;
+                    if (isSync != _isSync)
+                    {
+                        isSync = _isSync;
+                        params[RateSync].setVisible(isSync == 1);
+                        params[Speed].setVisible(isSync == 0);
+                    }
+                }
+                else
+                {
+                    params[IsSync].setVisible(false);
+                    params[RateSync].setVisible(false);
+                    params[Speed].setVisible(true);
+                    const auto isSyncParam = this->utils.getParam(params[IsSync].getPID());
+                    if (isSyncParam->getValueSum() > .5f)
+                        isSyncParam->setValueWithGesture(0.f);
+                }
             }
         };
 
@@ -676,7 +864,8 @@ namespace modSys6
                     envFol(u, "The envelope follower modulates the vibrato according to your input signal's energy."),
                     macro(u, "Directly manipulate the vibrato's internal delay with this modulator."),
                     pitchbend(u, "Use your pitchbend wheel to modulate the vibrato with this modulator."),
-                    lfo(u, "Modulate the vibrato with (more or less) classic LFO shapes.")
+                    lfo(u, "Modulate the vibrato with (more or less) classic LFO shapes."),
+                    curve(u, "Play back a recorded or drawn modulation curve, like real tape wow and flutter.")
                 {
                     perlin.onPaint = makeTextButtonOnPaint("Perlin");
                     audioRate.onPaint = makeTextButtonOnPaint("Audio\nRate");
@@ -685,6 +874,7 @@ namespace modSys6
                     macro.onPaint = makeTextButtonOnPaint("Macro");
                     pitchbend.onPaint = makeTextButtonOnPaint("Pitch\nBend");
                     lfo.onPaint = makeTextButtonOnPaint("LFO");
+                    curve.onPaint = makeTextButtonOnPaint("Curve");
 
                     perlin.onClick = makeOnClick(modComp, vibrato::ModType::Perlin);
                     audioRate.onClick = makeOnClick(modComp, vibrato::ModType::AudioRate);
@@ -693,6 +883,7 @@ namespace modSys6
                     macro.onClick = makeOnClick(modComp, vibrato::ModType::Macro);
                     pitchbend.onClick = makeOnClick(modComp, vibrato::ModType::Pitchwheel);
                     lfo.onClick = makeOnClick(modComp, vibrato::ModType::LFO);
+                    curve.onClick = makeOnClick(modComp, vibrato::ModType::Curve);
 
                     addAndMakeVisible(perlin);
                     addAndMakeVisible(audioRate);
@@ -701,10 +892,11 @@ namespace modSys6
                     addAndMakeVisible(macro);
                     addAndMakeVisible(pitchbend);
                     addAndMakeVisible(lfo);
+                    addAndMakeVisible(curve);
                 }
             protected:
                 nelG::Layout layout;
-                Button perlin, audioRate, dropout, envFol, macro, pitchbend, lfo;
+                Button perlin, audioRate, dropout, envFol, macro, pitchbend, lfo, curve;
 
                 void paint(juce::Graphics& g) override
                 {
@@ -727,6 +919,7 @@ namespace modSys6
                     layout.place(macro,     0, 1, 1, 1, thicc, false);
                     layout.place(pitchbend, 1, 1, 1, 1, thicc, false);
                     layout.place(lfo,       2, 1, 1, 1, thicc, false);
+                    layout.place(curve,     3, 1, 1, 1, thicc, false);
                 }
             };
 
@@ -746,7 +939,8 @@ namespace modSys6
 
         public:
             ModComp(Utils& u, std::vector<Paramtr*>& modulatables,
-                vibrato::LFOTables& _tables, int _mOff = 0) :
+                vibrato::LFOTablesBuilder& _tables, vibrato::EnvFolSettings& envFolSettings,
+                vibrato::CurveLoader& curveLoader, int _mOff = 0) :
                 Comp(u, makeNotify(*this), "", CursorType::Default),
                 layout(
                     { 80, 10, 10 },
@@ -763,10 +957,11 @@ namespace modSys6
                 perlin(u, modulatables, mOff),
                 audioRate(u, modulatables, mOff),
                 dropout(u, modulatables, mOff),
-                envFol(u, modulatables, mOff),
+                envFol(u, modulatables, envFolSettings, mOff),
                 macro(u, modulatables, mOff),
                 pitchbend(u, modulatables, mOff),
                 lfo(u, modulatables, _tables, mOff),
+                curve(u, modulatables, curveLoader, mOff),
 
                 randomizer(u, "ModRandomizer" + juce::String(mOff)),
                 selectorButton(u, "Select another modulator for this slot."),
@@ -801,6 +996,7 @@ namespace modSys6
                 addChildComponent(macro);
                 addChildComponent(pitchbend);
                 addChildComponent(lfo);
+                addChildComponent(curve);
 
                 addAndMakeVisible(randomizer);
                 addAndMakeVisible(selectorButton);
@@ -821,6 +1017,7 @@ namespace modSys6
                 macro.setVisible(false);
                 pitchbend.setVisible(false);
                 lfo.setVisible(false);
+                curve.setVisible(false);
                 randomizer.clear();
                 inputLabel.setText("");
 
@@ -857,6 +1054,10 @@ namespace modSys6
                     lfo.activate(randomizer);
                     label.setText("LFO");
                     break;
+                case ModType::Curve:
+                    curve.activate(randomizer);
+                    label.setText("Curve");
+                    break;
                 }
 
                 label.repaint();
@@ -888,6 +1089,7 @@ namespace modSys6
             ModCompMacro macro;
             ModCompPitchbend pitchbend;
             ModCompLFO lfo;
+            ModCompCurve curve;
 
             ParamtrRandomizer randomizer;
             Button selectorButton;
@@ -1,14 +1,19 @@
 #pragma once
 #include "../Interpolation.h"
 #include "../modsys/ModSys.h"
+#include "../releasePool/ReleasePool.h"
+#include "WavetableImport.h"
+#include "CurveFile.h"
+#include <map>
 #include <random>
+#include <variant>
 #define DebugAudioRateEnv false
 
 namespace vibrato
 {
 	enum class ObjType
 	{
-		ModType, InterpolationType, DelaySize, Wavetable, NumTypes
+		ModType, InterpolationType, DelaySize, Wavetable, Seed, EnvFol, Curve, NumTypes
 	};
 	inline juce::String toString(ObjType t)
 	{
@@ -18,6 +23,9 @@ namespace vibrato
 		case ObjType::InterpolationType: return "InterpolationType";
 		case ObjType::DelaySize: return "DelaySize";
 		case ObjType::Wavetable: return "Wavetable";
+		case ObjType::Seed: return "Seed";
+		case ObjType::EnvFol: return "EnvFol";
+		case ObjType::Curve: return "Curve";
 		default: return "";
 		}
 	}
@@ -35,6 +43,7 @@ namespace vibrato
 		Macro,
 		Pitchwheel,
 		LFO,
+		Curve,
 		//Rand, Trigger, Spline, Orbit
 		NumMods
 	};
@@ -49,6 +58,7 @@ namespace vibrato
 		case ModType::Macro: return "Macro";
 		case ModType::Pitchwheel: return "Pitchwheel";
 		case ModType::LFO: return "LFO";
+		case ModType::Curve: return "Curve";
 		//case ModType::Rand: return "Rand";
 		default: return "";
 		}
@@ -68,6 +78,170 @@ namespace vibrato
 		return ModType::Perlin;
 	}
 
+	// what the envelope follower listens to
+	enum class EnvFolMode { Peak, RMS, TruePeak, NumModes };
+	inline juce::String toString(EnvFolMode m)
+	{
+		switch (m)
+		{
+		case EnvFolMode::Peak: return "Peak";
+		case EnvFolMode::RMS: return "RMS";
+		case EnvFolMode::TruePeak: return "TruePeak";
+		default: return "";
+		}
+	}
+	inline EnvFolMode getEnvFolMode(const juce::String& str)
+	{
+		for (auto i = 0; i < static_cast<int>(EnvFolMode::NumModes); ++i)
+		{
+			const auto mode = static_cast<EnvFolMode>(i);
+			if (str == toString(mode))
+				return mode;
+		}
+		return EnvFolMode::Peak;
+	}
+
+	// envelope follower settings that aren't host parameters, set from the message thread.
+	// lookahead: the follower reads the input before the vibrato's latency, so it leads the audio
+	// sidechain: the follower listens to the sidechain bus, if it's connected
+	struct EnvFolSettings
+	{
+		EnvFolSettings() :
+			mode(EnvFolMode::Peak),
+			lookahead(true),
+			sidechain(false)
+		{}
+
+		std::atomic<EnvFolMode> mode;
+		std::atomic<bool> lookahead, sidechain;
+	};
+
+	// the audio that modulators can listen to. both point straight into the host's buffer
+	template<typename Float>
+	struct AudioInput
+	{
+		// the sidechain if it's wanted and connected, else the main input
+		const Float* const* get(bool useSidechain, int& numChannels) const noexcept
+		{
+			if (useSidechain && numChannelsSidechain != 0)
+			{
+				numChannels = numChannelsSidechain;
+				return sidechain;
+			}
+			numChannels = numChannelsMain;
+			return main;
+		}
+
+		const Float* const* main;
+		const Float* const* sidechain;
+		int numChannelsMain, numChannelsSidechain;
+	};
+
+	// the block's midi, decoded once from the raw bytes for all modulators.
+	// timestamps are at the host's rate and get mapped to each consumer's rate
+	struct MidiEvent
+	{
+		enum class Type : uint8_t { NoteOn, NoteOff, PitchWheel, CC };
+
+		int ts;
+		Type type;
+		int number, value; // note or cc number; velocity, cc value or 14 bit pitchwheel
+	};
+	struct MidiEvents
+	{
+		static constexpr int DefaultCapacity = 1 << 10;
+
+		MidiEvents() :
+			events()
+		{
+			events.reserve(DefaultCapacity);
+		}
+
+		// events beyond the capacity are dropped, so that the audio thread never allocates
+		void operator()(const juce::MidiBuffer& midi)
+		{
+			events.clear();
+			for (const auto ref : midi)
+			{
+				if (events.size() == events.capacity())
+					return;
+				if (ref.numBytes < 2)
+					continue;
+				const auto data = ref.data;
+				const auto status = data[0] & 0xf0;
+				const auto d1 = static_cast<int>(data[1]);
+				const auto d2 = ref.numBytes > 2 ? static_cast<int>(data[2]) : 0;
+				switch (status)
+				{
+				case 0x90:
+					events.push_back({ ref.samplePosition, d2 != 0 ? MidiEvent::Type::NoteOn : MidiEvent::Type::NoteOff, d1, d2 });
+					break;
+				case 0x80:
+					events.push_back({ ref.samplePosition, MidiEvent::Type::NoteOff, d1, d2 });
+					break;
+				case 0xe0:
+					events.push_back({ ref.samplePosition, MidiEvent::Type::PitchWheel, 0, d1 | (d2 << 7) });
+					break;
+				case 0xb0:
+					events.push_back({ ref.samplePosition, MidiEvent::Type::CC, d1, d2 });
+					break;
+				}
+			}
+		}
+
+		// timestamp at a rate of up / down times the host's rate, clipped to the block
+		static int getTimestamp(const MidiEvent& e, int up, int down, int numSamples) noexcept
+		{
+			return std::min(e.ts * up / down, numSamples);
+		}
+
+		const MidiEvent* begin() const noexcept { return events.data(); }
+		const MidiEvent* end() const noexcept { return events.data() + events.size(); }
+	protected:
+		std::vector<MidiEvent> events;
+	};
+
+	// the host's transport, read once per block and shared by all tempo synced modulators.
+	// tempo changes ramp from the previous block's bpm to this block's
+	struct Transport
+	{
+		Transport() :
+			hasPlayHead(false), isPlaying(false), isLooping(false),
+			bpm(120.), bpmLast(120.), ppq(0.), loopStart(0.), loopEnd(0.),
+			timeInSamples(0)
+		{}
+
+		void operator()(const juce::AudioPlayHead* playHead) noexcept
+		{
+			hasPlayHead = playHead != nullptr;
+			bpmLast = bpm;
+			isPlaying = false;
+			if (!hasPlayHead)
+				return;
+			const auto pos = playHead->getPosition();
+			if (!pos.hasValue())
+				return;
+			isPlaying = pos->getIsPlaying();
+			isLooping = pos->getIsLooping();
+			const auto _bpm = pos->getBpm().orFallback(bpm);
+			if (_bpm > 0.)
+				bpm = _bpm;
+			ppq = pos->getPpqPosition().orFallback(0.);
+			timeInSamples = pos->getTimeInSamples().orFallback(0);
+			if (const auto loop = pos->getLoopPoints())
+			{
+				loopStart = loop->ppqStart;
+				loopEnd = loop->ppqEnd;
+			}
+			if (!isPlaying)
+				bpmLast = bpm;
+		}
+
+		bool hasPlayHead, isPlaying, isLooping;
+		double bpm, bpmLast, ppq, loopStart, loopEnd;
+		juce::int64 timeInSamples;
+	};
+
 	template<typename Float>
 	struct Phasor
 	{
@@ -112,9 +286,12 @@ namespace vibrato
 		Float fs, fsInv;
 	};
 
+	// adsr with exponential segments, rendered segment-wise in closed form.
+	// the attack's end is computed from its coefficient, so no per sample state checks are needed
 	struct EnvGen
 	{
 		enum class State { A, D, R };
+		static constexpr float AttackEnd = .99f;
 
 		EnvGen() :
 			attack(1.f), decay(1.f), sustain(1.f), release(1.f),
@@ -123,31 +300,70 @@ namespace vibrato
 			state(State::R),
 			noteOn(false),
 
-			smooth()
+			bA(0.f), bD(0.f), bR(0.f)
 		{}
 		void prepare(float sampleRate)
 		{
 			Fs = sampleRate;
-			switch (state)
+			bA = makeCoeff(attack);
+			bD = makeCoeff(decay);
+			bR = makeCoeff(release);
+		}
+		void setParameters(float _attack, float _decay, float _sustain, float _release) noexcept
+		{
+			if (attack != _attack)
+			{
+				attack = _attack;
+				bA = makeCoeff(attack);
+			}
+			if (decay != _decay)
 			{
-			case State::A: modSys6::Smooth::makeFromDecayInMs(smooth, attack, Fs);
-			case State::D: modSys6::Smooth::makeFromDecayInMs(smooth, decay, Fs);
-			case State::R: modSys6::Smooth::makeFromDecayInMs(smooth, release, Fs);
+				decay = _decay;
+				bD = makeCoeff(decay);
+			}
+			if (release != _release)
+			{
+				release = _release;
+				bR = makeCoeff(release);
 			}
+			sustain = _sustain;
 		}
-		float operator()(bool n) noexcept
+		void setNoteOn(bool n) noexcept
 		{
 			noteOn = n;
-			return processSample();
-		}
-		float operator()() noexcept
-		{
-			return processSample();
+			if (!noteOn)
+				state = State::R;
+			else if (state == State::R)
+				state = State::A;
 		}
 		void retrig() noexcept
 		{
 			state = State::A;
 		}
+		void reset() noexcept
+		{
+			env = 0.f;
+			state = State::R;
+			noteOn = false;
+		}
+
+		void operator()(float* buffer, int numSamples) noexcept
+		{
+			auto s = 0;
+			if (state == State::A)
+			{
+				const auto attackLength = getAttackLength();
+				if (attackLength > numSamples)
+					return renderSegment(buffer, 0, numSamples, 1.f, bA);
+				renderSegment(buffer, 0, attackLength, 1.f, bA);
+				s = attackLength;
+				state = State::D;
+			}
+			if (state == State::D)
+				renderSegment(buffer, s, numSamples, sustain, bD);
+			else
+				renderSegment(buffer, s, numSamples, 0.f, bR);
+		}
 
 		float attack, decay, sustain, release;
 
@@ -155,48 +371,93 @@ namespace vibrato
 		State state;
 		bool noteOn;
 	protected:
-		modSys6::Smooth smooth;
+		float bA, bD, bR;
+
+		float makeCoeff(float ms) const noexcept
+		{
+			return std::exp(-1.f / (ms * Fs * .001f));
+		}
 
-		float processSample() noexcept
+		// number of samples until the attack segment reaches AttackEnd
+		int getAttackLength() const noexcept
 		{
-			switch (state)
+			if (env >= AttackEnd)
+				return 0;
+			if (bA <= 0.f)
+				return 1;
+			const auto length = std::ceil(std::log((1.f - AttackEnd) / (1.f - env)) / std::log(bA));
+			return length < 1.f ? 1 : static_cast<int>(length);
+		}
+
+		// env(n) = target + (env - target) * b^n
+		void renderSegment(float* buffer, int start, int end, float target, float b) noexcept
+		{
+			if (env == target)
+				return juce::FloatVectorOperations::fill(buffer + start, env, end - start);
+			auto dist = env - target;
+			for (auto s = start; s < end; ++s)
 			{
-			case State::A:
-				if (noteOn)
-					if (env < .99f)
-						env = smooth(1.f);
-					else
-					{
-						state = State::D;
-						modSys6::Smooth::makeFromDecayInMs(smooth, decay, Fs);
-					}
-				else
-				{
-					state = State::R;
-					modSys6::Smooth::makeFromDecayInMs(smooth, release, Fs);
-				}
-				break;
-			case State::D:
-				if (noteOn)
-					env = smooth(sustain);
-				else
-				{
-					state = State::R;
-					modSys6::Smooth::makeFromDecayInMs(smooth, release, Fs);
-				}
-				break;
-			case State::R:
-				if (!noteOn)
-					env = smooth(0.f);
-				else
-				{
-					state = State::A;
-					modSys6::Smooth::makeFromDecayInMs(smooth, attack, Fs);
-				}
-				break;
+				dist *= b;
+				buffer[s] = target + dist;
+			}
+			env = std::abs(dist) < 1e-6f ? target : target + dist;
+		}
+	};
+
+	// midi note to frequency in hz, linearly interpolated from a table in quarter semitones.
+	// the note range is the one of the oscillator's frequency range (1hz - 22049hz)
+	struct NoteToFreq
+	{
+		static constexpr float MinNote = -37.f;
+		static constexpr float MaxNote = 137.f;
+		static constexpr float Resolution = 4.f;
+
+		NoteToFreq() :
+			table()
+		{
+			const auto size = static_cast<int>((MaxNote - MinNote) * Resolution) + 2;
+			table.resize(size);
+			for (auto i = 0; i < size; ++i)
+			{
+				const auto note = MinNote + static_cast<float>(i) / Resolution;
+				const auto freq = 440.f * std::pow(2.f, (note - 69.f) * .083333333333f);
+				table[i] = juce::jlimit(1.f, 22049.f, freq);
 			}
-			return env;
 		}
+		float operator()(float note) const noexcept
+		{
+			const auto x = (juce::jlimit(MinNote, MaxNote, note) - MinNote) * Resolution;
+			const auto i = static_cast<int>(x);
+			const auto frac = x - static_cast<float>(i);
+			return table[i] + frac * (table[i + 1] - table[i]);
+		}
+	protected:
+		std::vector<float> table;
+	};
+
+	// one cosine cycle, linearly interpolated
+	struct CosTable
+	{
+		static constexpr int Size = 1 << 11;
+		static constexpr float SizeF = static_cast<float>(Size);
+
+		CosTable() :
+			table()
+		{
+			table.resize(Size + 1);
+			for (auto i = 0; i < table.size(); ++i)
+				table[i] = std::cos(approx::Tau * static_cast<float>(i) / SizeF);
+		}
+		// phase in [0, 1)
+		float operator()(float phase) const noexcept
+		{
+			const auto x = phase * SizeF;
+			const auto i = static_cast<int>(x);
+			const auto frac = x - static_cast<float>(i);
+			return table[i] + frac * (table[i + 1] - table[i]);
+		}
+	protected:
+		std::vector<float> table;
 	};
 
 	template<size_t Size>
@@ -287,6 +548,44 @@ namespace vibrato
 				auto x = 2.f * static_cast<float>(s) * SizeInv - 1.f;
 				table[s] = func(x);
 			}
+			finishFill(removeDC, normalize);
+		}
+		// takes Size samples of one cycle, like from an imported file
+		void fill(const float* samples, bool removeDC, bool normalize)
+		{
+			for (auto s = 0; s < Size; ++s)
+				table[s] = samples[s];
+			finishFill(removeDC, normalize);
+		}
+
+		float operator[](float x) const noexcept
+		{
+			static constexpr float SizeF = static_cast<float>(Size);
+			x = x * SizeF;
+			const auto xFloor = std::floor(x);
+			const auto i0 = static_cast<int>(xFloor);
+			const auto i1 = i0 + 1;
+			const auto frac = x - xFloor;
+			return table[i0] + frac * (table[i1] - table[i0]);
+		}
+		float operator[](int idx) const noexcept
+		{
+			return table[idx];
+		}
+		const float* data() const noexcept { return table.data(); }
+		void copyFrom(const float* samples) noexcept
+		{
+			for (auto s = 0; s < Size; ++s)
+				table[s] = samples[s];
+			for (auto s = Size; s < table.size(); ++s)
+				table[s] = table[s - Size];
+		}
+	protected:
+		std::array<float, Size + 2> table;
+
+		void finishFill(bool removeDC, bool normalize)
+		{
+			static constexpr float SizeInv = 1.f / static_cast<float>(Size);
 
 			if (removeDC)
 			{
@@ -320,23 +619,6 @@ namespace vibrato
 			for (auto s = Size; s < table.size(); ++s)
 				table[s] = table[s - Size];
 		}
-		
-		float operator[](float x) const noexcept
-		{
-			static constexpr float SizeF = static_cast<float>(Size);
-			x = x * SizeF;
-			const auto xFloor = std::floor(x);
-			const auto i0 = static_cast<int>(xFloor);
-			const auto i1 = i0 + 1;
-			const auto frac = x - xFloor;
-			return table[i0] + frac * (table[i1] - table[i0]);
-		}
-		float operator[](int idx) const noexcept
-		{
-			return table[idx];
-		}
-	protected:
-		std::array<float, Size + 2> table;
 	};
 
 	template<size_t WTSize, size_t NumTables>
@@ -402,15 +684,23 @@ namespace vibrato
 		Tables tables;
 	};
 
+	// exponent of a power of 2
+	inline constexpr int getOrder(size_t n) noexcept { return n < 2 ? 0 : 1 + getOrder(n / 2); }
+
 	template<size_t WTSize, size_t NumTables>
 	struct Wavetable3D
 	{
 		using Func = std::function<float(float x)>;
 		using Funcs = std::array<Func, NumTables>;
 		using Tables = Wavetable3D<WTSize, NumTables>;
+		static constexpr int Order = getOrder(WTSize);
+		static constexpr int NumMips = Order; // down to a sine wave
+		static constexpr int TableSize = static_cast<int>(WTSize);
+		static constexpr int NumFrames = static_cast<int>(NumTables);
 
 		void makeTablesWeierstrasz()
 		{
+			++version;
 			name = "Weierstrasz";
 			tables[0].makeTableWeierstrasz(0.f, 0.f, 1);
 			tables[1].makeTableWeierstrasz(.0625f, 7.f, 8);
@@ -420,30 +710,64 @@ namespace vibrato
 			tables[5].makeTableWeierstrasz(.3125f, 3.f, 4);
 			tables[6].makeTableWeierstrasz(.375f, 3.f, 3);
 			tables[7].makeTableWeierstrasz(.4375f, 2.f, 6);
+			makeMips();
 		}
 		void makeTablesTriangles()
 		{
+			++version;
 			name = "Triangle";
 			for (auto n = 0; n < NumTables; ++n)
 				tables[n].makeTableTriangle(n);
+			makeMips();
 		}
 		void makeTablesSinc()
 		{
+			++version;
 			name = "Sinc";
 			for (auto n = 0; n < NumTables; ++n)
 				tables[n].makeTableSinc(true, n + 1);
+			makeMips();
+		}
+		// frames holds NumFrames cycles of TableSize samples each
+		void makeTablesFromFrames(const float* frames, const juce::String& _name)
+		{
+			++version;
+			name = _name;
+			for (auto n = 0; n < NumTables; ++n)
+				tables[n].fill(frames + n * WTSize, true, true);
+			tables.finishFills();
+			makeMips();
 		}
 
 		Wavetable3D() :
 			tables(),
-			name("empty table")
+			name("empty table"),
+			version(0),
+			mips(NumMips - 1)
 		{}
 		
 		void fill(const Funcs& funcs, bool removeDC, bool normalize)
 		{
+			++version;
 			for (auto f = 0; f < NumTables; ++f)
 				tables.fill(funcs[f], f, removeDC, normalize);
 			tables.finishFills();
+			makeMips();
+		}
+
+		// mip 0 is the full bandwidth table, every following mip has half the harmonics
+		const Wavetable<WTSize>& getTable(int mip, int tableIdx) const noexcept
+		{
+			return mip == 0 ? tables[tableIdx] : mips[mip - 1][tableIdx];
+		}
+		// lowest mip without harmonics above nyquist at the phase increment inc
+		static int getMip(float inc) noexcept
+		{
+			const auto highestHarmonic = inc * static_cast<float>(WTSize);
+			if (highestHarmonic <= 1.f)
+				return 0;
+			const auto mip = static_cast<int>(std::ceil(std::log2(highestHarmonic)));
+			return mip < NumMips ? mip : NumMips - 1;
 		}
 		
 		float operator()(float tablesPhase, float tablePhase) const noexcept
@@ -465,9 +789,41 @@ namespace vibrato
 
 		Wavetable2D<WTSize, NumTables> tables;
 		juce::String name;
+		// changes whenever the tables get rewritten, so that users can invalidate their caches
+		int version;
+	protected:
+		std::vector<Wavetable2D<WTSize, NumTables>> mips;
+
+		// band-limits each table per octave by truncating its spectrum
+		void makeMips()
+		{
+			juce::dsp::FFT fft(Order);
+			std::vector<float> spectrum, bins;
+			spectrum.resize(WTSize * 2, 0.f);
+			bins.resize(WTSize * 2, 0.f);
+			for (auto t = 0; t < NumTables; ++t)
+			{
+				std::fill(spectrum.begin(), spectrum.end(), 0.f);
+				std::copy(tables[t].data(), tables[t].data() + WTSize, spectrum.begin());
+				fft.performRealOnlyForwardTransform(spectrum.data());
+
+				for (auto mip = 1; mip < NumMips; ++mip)
+				{
+					const auto maxHarmonic = static_cast<int>(WTSize / 2) >> mip;
+					bins = spectrum;
+					for (auto k = maxHarmonic + 1; k < WTSize - maxHarmonic; ++k)
+					{
+						bins[2 * k] = 0.f;
+						bins[2 * k + 1] = 0.f;
+					}
+					fft.performRealOnlyInverseTransform(bins.data());
+					mips[mip - 1][t].copyFrom(bins.data());
+				}
+			}
+		}
 	};
 
-	enum TableType { Weierstrasz, Tri, Sinc, NumTypes };
+	enum TableType { Weierstrasz, Tri, Sinc, User, NumTypes };
 	inline juce::String toString(TableType t)
 	{
 		switch (t)
@@ -475,146 +831,379 @@ namespace vibrato
 		case TableType::Weierstrasz: return "Weierstrasz";
 		case TableType::Tri: return "Triangle";
 		case TableType::Sinc: return "Sinc";
+		case TableType::User: return "User";
 		default: return "";
 		}
 	}
 
-	static constexpr int LFOTableSize = 1 << 11;
-	static constexpr int LFONumTables = 8;
-	using LFOTables = Wavetable3D<LFOTableSize, LFONumTables>;
-
-	// creates a modulator curve mapped to [-1, 1]
-	// of some ModType (like perlin, audiorate, dropout etc.)
-	class Modulator
+	// provides tables for the worker thread of its owner, which calls process, and publishes them with a pointer swap.
+	// the built-in table sets are only generated once per process and shared read-only,
+	// and they only get bound once an lfo needs them.
+	// old tables get reclaimed by the release pool, so that the audio thread never frees them.
+	// requests only store an atomic and wake the worker, so they can come from any thread (also patch loading)
+	// user tables get imported from a file by the worker, see WavetableImport.h.
+	// their type and file only get published once the import succeeded, so patches never refer to a half loaded file
+	template<class Tables>
+	class TablesBuilder
 	{
-		static constexpr float SafetyCoeff = .99f;
-		using Buffer = std::array<std::vector<float>, 4>;
-		using BeatsData = modSys6::BeatsData;
-		using Tables = LFOTables;
+	public:
+		TablesBuilder(TableType defaultType, juce::Thread& _worker) :
+			worker(_worker),
+			tables(std::shared_ptr<Tables>()),
+			type(defaultType),
+			request(-1),
+			boundType(-1),
+			userMutex(),
+			requestedFile(),
+			userFile(),
+			requestedHash(0),
+			userHash(0)
+		{
+		}
 
-		class Perlin
+		void requestTables(TableType t)
+		{
+			type.store(t);
+			request.store(t);
+			worker.notify();
+		}
+		// hash identifies the file's content, so that its cache can stand in if the file went missing
+		void requestUserTables(const juce::File& file, uint64_t hash = 0)
 		{
-			struct Perlinizer
 			{
-				Perlinizer() :
-					octaves(-1),
-					gainAccum(1.f)
-				{}
-				void setParameters(const float* sclInv, int _octaves) noexcept
-				{
-					if (octaves != _octaves)
-					{
-						octaves = _octaves;
-						gainAccum = 0.f;
-						for (auto o = 0; o < octaves; ++o)
-							gainAccum += sclInv[o];
-						gainAccum = 1.f / gainAccum;
-					}
-				}
-				void operator()(float* buffer, const float* phasorBuf, 
-					const float* scl, const float* sclInv, const float* noise, 
-					float noiseSizeF, float phaseOffset, int numSamples, const int* octBuf) noexcept
-				{
-					for (auto s = 0; s < numSamples; ++s)
-					{
-						setParameters(sclInv, octBuf[s]);
+				const juce::SpinLock::ScopedLockType lock(userMutex);
+				requestedFile = file;
+			}
+			requestedHash.store(hash);
+			request.store(TableType::User);
+			worker.notify();
+		}
+		TableType getType() const noexcept { return static_cast<TableType>(type.load()); }
+		// the file of the currently loaded user tables
+		juce::File getUserFile() const
+		{
+			const juce::SpinLock::ScopedLockType lock(userMutex);
+			return userFile;
+		}
+		uint64_t getUserHash() const noexcept { return userHash.load(); }
 
-						auto smpl = 0.f;
-						for (int o = 0; o < octaves; ++o)
-						{
-							auto x = phasorBuf[s] * scl[o] + phaseOffset;
-							while (x >= noiseSizeF)
-								x -= noiseSizeF;
-							smpl += interpolation::cubicHermiteSpline(noise, x) * sclInv[o];
-						}
-						smpl *= gainAccum;
-						buffer[s] = smpl;
-					}
-				}
-				void operator()(float* buffer, const float* phasorBuf,
-					const float* scl, const float* sclInv, const float* noise,
-					float noiseSizeF, float phaseOffset, int numSamples,
-					const int* octBuf, const float* mix) noexcept
-				{
-					for (auto s = 0; s < numSamples; ++s)
-					{
-						setParameters(sclInv, octBuf[s]);
+		// audio thread. nullptr until an lfo needed them
+		std::shared_ptr<Tables> updateAndLoad() noexcept { return tables.updateAndLoadCurrentPtr(); }
+		// any other thread. nullptr until an lfo needed them
+		std::shared_ptr<Tables> load() { return tables.loadUpdatedPtr(); }
 
-						auto smpl = 0.f;
-						for (int o = 0; o < octaves; ++o)
-						{
-							auto x = phasorBuf[s] * scl[o] + phaseOffset;
-							while (x >= noiseSizeF)
-								x -= noiseSizeF;
-							smpl += interpolation::cubicHermiteSpline(noise, x) * sclInv[o];
-						}
-						smpl *= gainAccum;
-						buffer[s] += mix[s] * (smpl - buffer[s]);
-					}
+		// worker thread. needed tells if an lfo is going to read the tables
+		void process(bool needed)
+		{
+			if (request.exchange(-1) == TableType::User)
+			{ // KEEPS THE CURRENT TABLES IF THE IMPORT FAILS
+				if (auto userTables = getUserTables())
+				{
+					tables.replaceUpdatedPtrWith(userTables);
+					type.store(TableType::User);
+					boundType = TableType::User;
 				}
-			protected:
-				float gainAccum;
-				int octaves;
-			};
-		public:
-			Perlin(int _numChannels, int _maxNumOctaves) :
-				freqSmooth(false), widthSmooth(false), octSmooth(false, 4.f),
-
-				phasor(),
-
-				noise(), scl(), sclInv(),
-
-				fs(0.f),
-
-				rate(-1.f), width(-1.f),
+			}
+			const auto t = type.load();
+			if (needed && t != boundType)
+			{
+				tables.replaceUpdatedPtrWith(getSharedTables(static_cast<TableType>(t)));
+				boundType = t;
+			}
+		}
+	protected:
+		juce::Thread& worker;
+		RealtimePtr<Tables> tables;
+		std::atomic<int> type, request;
+		int boundType;
+		mutable juce::SpinLock userMutex;
+		juce::File requestedFile, userFile;
+		std::atomic<uint64_t> requestedHash, userHash;
+
+		// instances importing the same file share its tables as long as any of them uses it
+		std::shared_ptr<Tables> getUserTables()
+		{
+			static juce::CriticalSection mutex;
+			static std::map<uint64_t, std::weak_ptr<Tables>> sharedTables;
 
-				perlinizer0(), perlinizer1(),
+			juce::File file;
+			{
+				const juce::SpinLock::ScopedLockType lock(userMutex);
+				file = requestedFile;
+			}
+			std::vector<float> frames;
+			uint64_t hash = 0;
+			if (!wtImport::load(file, frames, Tables::NumFrames, Tables::TableSize, requestedHash.load(), hash))
+				return nullptr;
 
-				maxNumOctaves(_maxNumOctaves),
-				noiseSize(1 << maxNumOctaves),
-				noiseSizeF(static_cast<float>(noiseSize)),
-				noiseSizeInv(.5f / noiseSizeF),
-				noiseSizeHalf(noiseSizeF * .5f),
+			std::shared_ptr<Tables> tbls;
+			{
+				const juce::ScopedLock lock(mutex);
+				tbls = sharedTables[hash].lock();
+				if (tbls == nullptr)
+				{
+					tbls = std::make_shared<Tables>();
+					tbls->makeTablesFromFrames(frames.data(), file.getFileNameWithoutExtension());
+					sharedTables[hash] = tbls;
+				}
+			}
+			{
+				const juce::SpinLock::ScopedLockType lock(userMutex);
+				userFile = file;
+			}
+			userHash.store(hash);
+			return tbls;
+		}
 
-				widthV(1.f),
+		static std::shared_ptr<Tables> getSharedTables(TableType t)
+		{
+			static juce::CriticalSection mutex;
+			static std::array<std::shared_ptr<Tables>, TableType::User> sharedTables;
 
-				numChannels(_numChannels)
+			const juce::ScopedLock lock(mutex);
+			auto& tbls = sharedTables[t < TableType::User ? t : TableType::Weierstrasz];
+			if (tbls == nullptr)
 			{
-				scl.reserve(maxNumOctaves + 1);
-				sclInv.reserve(maxNumOctaves + 1);
-				for (auto o = 0; o < maxNumOctaves + 1; ++o)
+				tbls = std::make_shared<Tables>();
+				switch (t)
 				{
-					scl.emplace_back(static_cast<float>(1 << o));
-					sclInv.emplace_back(1.f / scl[o]);
+				case TableType::Tri: tbls->makeTablesTriangles(); break;
+				case TableType::Sinc: tbls->makeTablesSinc(); break;
+				default: tbls->makeTablesWeierstrasz(); break;
 				}
+			}
+			return tbls;
+		}
+	};
 
-				noise.resize(noiseSize + 4); // + splineSize
+	static constexpr int LFOTableSize = 1 << 11;
+	static constexpr int LFONumTables = 8;
+	using LFOTables = Wavetable3D<LFOTableSize, LFONumTables>;
+	using LFOTablesBuilder = TablesBuilder<LFOTables>;
 
-				unsigned int seed = 420 * 69 / 666 * 42;
-				std::random_device rd;
-				std::mt19937 mt(rd());
-				std::uniform_real_distribution<float> dist(-.89f, .89f); // compensate spline overshoot
+	// maps curve files for the worker thread of its owner and publishes them with a pointer swap, like TablesBuilder.
+	// the old curve gets reclaimed by the release pool, so the audio thread never unmaps it
+	class CurveLoader
+	{
+	public:
+		CurveLoader(juce::Thread& _worker) :
+			worker(_worker),
+			curve(std::shared_ptr<curveFile::Curve>()),
+			requested(false),
+			fileMutex(),
+			requestedFile(),
+			file(),
+			requestedHash(0),
+			hash(0)
+		{
+		}
 
-				for (auto s = 0; s < noiseSize; ++s, ++seed)
+		// hash identifies the source's content, so that its curve file can stand in if the source went missing
+		void requestCurve(const juce::File& f, uint64_t h = 0)
+		{
+			{
+				const juce::SpinLock::ScopedLockType lock(fileMutex);
+				requestedFile = f;
+			}
+			requestedHash.store(h);
+			requested.store(true);
+			worker.notify();
+		}
+		// the source of the currently loaded curve
+		juce::File getFile() const
+		{
+			const juce::SpinLock::ScopedLockType lock(fileMutex);
+			return file;
+		}
+		uint64_t getHash() const noexcept { return hash.load(); }
+
+		// audio thread. nullptr if no curve was loaded yet
+		std::shared_ptr<curveFile::Curve> updateAndLoad() noexcept { return curve.updateAndLoadCurrentPtr(); }
+
+		// worker thread
+		void process()
+		{
+			if (!requested.exchange(false))
+				return;
+			juce::File f;
+			{
+				const juce::SpinLock::ScopedLockType lock(fileMutex);
+				f = requestedFile;
+			}
+			if (auto c = curveFile::load(f, requestedHash.load()))
+			{
+				curve.replaceUpdatedPtrWith(c);
 				{
-					mt.seed(seed);
-					noise[s] = dist(mt);
+					const juce::SpinLock::ScopedLockType lock(fileMutex);
+					file = f;
 				}
-				for (auto s = noiseSize; s < noise.size(); ++s)
-					noise[s] = noise[s - noiseSize];
+				hash.store(c->getHash());
+			}
+		}
+	protected:
+		juce::Thread& worker;
+		RealtimePtr<curveFile::Curve> curve;
+		std::atomic<bool> requested;
+		mutable juce::SpinLock fileMutex;
+		juce::File requestedFile, file;
+		std::atomic<uint64_t> requestedHash, hash;
+	};
+
+	// expands a control rate signal to audio rate with cubic hermite interpolation.
+	// it needs one control sample in advance, so the output lags 2 control samples behind
+	struct ControlRateUpsampler
+	{
+		ControlRateUpsampler() :
+			history(),
+			ctrPhase(1), decimation(1),
+			decimationInv(1.f)
+		{}
+
+		// restarts the interpolation from the last values of the output
+		void reset(int _decimation, const float* lastValues, int numChannels) noexcept
+		{
+			decimation = _decimation;
+			decimationInv = 1.f / static_cast<float>(decimation);
+			ctrPhase = decimation;
+			for (auto ch = 0; ch < numChannels; ++ch)
+				history[ch].fill(lastValues[ch]);
+		}
+
+		int getDecimation() const noexcept { return decimation; }
+		int getNumControlSamples(int numSamples) const noexcept
+		{
+			return (ctrPhase + numSamples - 1) / decimation;
+		}
+
+		void operator()(float* const* dest, const float* const* ctrl, int numChannels, int numSamples) noexcept
+		{
+			auto phase = ctrPhase;
+			for (auto ch = 0; ch < numChannels; ++ch)
+			{
+				auto& h = history[ch];
+				const auto c = ctrl[ch];
+				auto d = dest[ch];
+				auto j = 0;
+				phase = ctrPhase;
+				for (auto s = 0; s < numSamples; ++s)
+				{
+					if (phase == decimation)
+					{
+						h[0] = h[1];
+						h[1] = h[2];
+						h[2] = h[3];
+						h[3] = c[j];
+						++j;
+						phase = 0;
+					}
+					d[s] = interpolation::cubicHermiteSpline(h.data(), static_cast<float>(phase) * decimationInv);
+					++phase;
+				}
+			}
+			ctrPhase = phase;
+		}
+	protected:
+		std::array<std::array<float, 4>, 2> history;
+		int ctrPhase, decimation;
+		float decimationInv;
+	};
+
+	// creates a modulator curve mapped to [-1, 1]
+	// of some ModType (like perlin, audiorate, dropout etc.)
+	class Modulator
+	{
+		static constexpr float SafetyCoeff = .99f;
+		// control rate must be this much higher than a modulator's bandwidth
+		static constexpr float ControlRateHeadroom = 16.f;
+		static constexpr int MaxDecimation = 32;
+		static constexpr int NumBufferChannels = 4;
+
+		// channels 0 and 1 are the output, 2 and 3 the engines' scratch space.
+		// the memory is owned by whoever prepares the modulator (the bank's pool)
+		struct Buffer
+		{
+			struct Channel
+			{
+				float* data() const noexcept { return ptr; }
+				float& operator[](int s) const noexcept { return ptr[s]; }
+
+				float* ptr;
+			};
+
+			Channel& operator[](int ch) noexcept { return chans[ch]; }
+			const Channel& operator[](int ch) const noexcept { return chans[ch]; }
+
+			std::array<Channel, NumBufferChannels> chans;
+		};
+		using BeatsData = modSys6::BeatsData;
+		using Tables = LFOTables;
+
+		class Perlin
+		{
+			static constexpr int NumLanes = 8;
+			static constexpr int FracBits = 24;
+			static constexpr uint64_t FracMask = (uint64_t(1) << FracBits) - 1;
+			static constexpr float FracScale = 1.f / static_cast<float>(uint64_t(1) << FracBits);
+			static constexpr double PosScale = 18446744073709551616.; // 2^64 == whole noise table
+			static constexpr uint64_t PosHalf = uint64_t(1) << 63;
+
+			using Lanes = std::array<float, NumLanes>;
+			using LanesIdx = std::array<int, NumLanes>;
+			// cubic hermite coefficients of each noise cell (SoA)
+			using Cells = std::array<std::vector<float>, 4>;
+		public:
+			Perlin(int _numChannels, int _maxNumOctaves) :
+				freqSmooth(false), widthSmooth(false), octSmooth(false, 4.f),
+
+				cells(nullptr), scl(), sclInv(), gainInv(),
+				posBuf(), octFloorBuf(),
+				weights(), weightsOct(-1), weightsMix(-1.f),
+
+				fs(0.f), fsInv(1.),
+				pos(0), posOffset(0),
+
+				rate(-1.f), width(-1.f), octaves(1.f),
+
+				maxNumOctaves(juce::jmin(_maxNumOctaves, NumLanes)),
+				noiseSize(1 << maxNumOctaves),
+				noiseSizeF(static_cast<float>(noiseSize)),
+				noiseSizeInv(.5f / noiseSizeF),
+				idxShift(64 - maxNumOctaves),
+				fracShift(idxShift - FracBits),
+
+				widthV(1.f), widthLast(1.f),
+
+				numChannels(_numChannels)
+			{
+				scl.reserve(maxNumOctaves + 1);
+				sclInv.reserve(maxNumOctaves + 1);
+				for (auto o = 0; o < maxNumOctaves + 1; ++o)
+				{
+					scl.emplace_back(static_cast<float>(1 << o));
+					sclInv.emplace_back(1.f / scl[o]);
+				}
+				// gain normalisation for each number of octaves
+				gainInv.resize(maxNumOctaves + 2, 1.f);
+				{
+					auto gainAccum = 0.f;
+					for (auto o = 1; o < gainInv.size(); ++o)
+					{
+						gainAccum += sclInv[o - 1];
+						gainInv[o] = 1.f / gainAccum;
+					}
+				}
+
+				cells = getSharedCells(maxNumOctaves);
 			}
 
 			void prepare(float sampleRate, int blockSize) noexcept
 			{
+				posBuf.resize(blockSize, 0);
+				octFloorBuf.resize(blockSize, static_cast<int>(std::floor(octaves)));
 				if (fs != sampleRate)
 				{
-					const auto oFloor = static_cast<int>(std::floor(octaves));
-					octFloorBuf.resize(blockSize, oFloor);
-					octCeilBuf.resize(blockSize, oFloor + 1);
 					fs = sampleRate;
-					phasor.prepare(static_cast<double>(sampleRate));
-					widthSmooth.reset();
-					freqSmooth.reset();
+					fsInv = 1. / static_cast<double>(fs);
 					modSys6::Smooth::makeFromDecayInMs(octSmooth, 10.f, sampleRate);
 					modSys6::Smooth::makeFromDecayInMs(widthSmooth, 10.f, sampleRate);
 					modSys6::Smooth::makeFromDecayInMs(freqSmooth, 10.f, sampleRate);
@@ -634,15 +1223,37 @@ namespace vibrato
 				}
 			}
 
+			// the seed picks where on the (shared, deterministic) noise the modulator starts.
+			// it moves there right away, so that an engine that never gets reset doesn't start at 0
+			void setSeed(uint64_t seed) noexcept
+			{
+				posOffset = prng::splitMix64(seed);
+				pos = posOffset;
+			}
+			// restarts at the seed's position with settled parameters
+			void reset() noexcept
+			{
+				pos = posOffset;
+				freqSmooth.setValue(rate);
+				octSmooth.setValue(octaves);
+				widthSmooth.setValue(widthV);
+				widthLast = widthV;
+			}
+
+			// the highest octave's cell rate
+			float getBandwidth() const noexcept
+			{
+				return rate * .5f * std::exp2(octaves);
+			}
+
 			void operator()(Buffer& buffer, int numChannelsOut, int numSamples) noexcept
 			{
-				// SYNTHESIZE PHASE BUFFER
-				auto phasorBuf = buffer[2].data();
+				// SYNTHESIZE PHASE BUFFER (FIXED POINT, WRAPS BY OVERFLOW)
 				for (auto s = 0; s < numSamples; ++s)
 				{
 					const auto freqHz = static_cast<double>(freqSmooth(rate) * noiseSizeInv);
-					phasor.setFrequencyHz(freqHz);
-					phasorBuf[s] = static_cast<float>(phasor.process()) * noiseSizeF;
+					pos += static_cast<uint64_t>(freqHz * fsInv * PosScale);
+					posBuf[s] = pos;
 				}
 				
 				// SYNTHESIZE OCT BUFFERS
@@ -653,105 +1264,180 @@ namespace vibrato
 					const auto oFloorF = std::floor(octV);
 					octBuf[s] = octV - oFloorF;
 					octFloorBuf[s] = static_cast<int>(oFloorF);
-					octCeilBuf[s] = octFloorBuf[s] + 1;
 				}
 
 				// PERFORM PERLIN NOISE
-				synthesizePerlin(buffer[0].data(), phasorBuf, octBuf, 0.f, numSamples);
+				synthesizePerlin(buffer[0].data(), octBuf, 0, numSamples);
 
 				if (numChannelsOut == 2)
 				{
-					synthesizePerlin(buffer[1].data(), phasorBuf, octBuf, noiseSizeHalf, numSamples);
+					if (widthV == 0.f && widthLast < WidthEps)
+						return juce::FloatVectorOperations::copy(buffer[1].data(), buffer[0].data(), numSamples);
+
+					synthesizePerlin(buffer[1].data(), octBuf, PosHalf, numSamples);
 
 					for (auto s = 0; s < numSamples; ++s)
-						buffer[1][s] = buffer[0][s] + widthSmooth(widthV) * (buffer[1][s] - buffer[0][s]);
+					{
+						widthLast = widthSmooth(widthV);
+						buffer[1][s] = buffer[0][s] + widthLast * (buffer[1][s] - buffer[0][s]);
+					}
 				}
 			}
 		protected:
 			modSys6::Smooth freqSmooth, widthSmooth, octSmooth;
 
-			Phasor<double> phasor;
-			std::vector<float> noise, scl, sclInv;
-			std::vector<int> octFloorBuf, octCeilBuf;
+			static constexpr float WidthEps = 1e-5f;
+
+			std::shared_ptr<const Cells> cells;
+			std::vector<float> scl, sclInv, gainInv;
+			std::vector<uint64_t> posBuf;
+			std::vector<int> octFloorBuf;
+			alignas(32) Lanes weights;
+			int weightsOct;
+			float weightsMix;
 
 			float fs;
+			double fsInv;
+			uint64_t pos, posOffset;
 
 			float rate, width, octaves;
 
-			Perlinizer perlinizer0, perlinizer1;
-
 			const int maxNumOctaves;
 			const int noiseSize;
-			const float noiseSizeF, noiseSizeInv, noiseSizeHalf;
+			const float noiseSizeF, noiseSizeInv;
+			const int idxShift, fracShift;
 
-			float widthV;
+			float widthV, widthLast;
 
 			const int numChannels;
 
-			void synthesizePerlin(float* buffer, const float* phasorBuf, const float* octBuf,
-				float phaseOffset, int numSamples) noexcept
+			// the noise is deterministic, so it's generated once per process and size
+			static std::shared_ptr<const Cells> getSharedCells(int numOctaves)
 			{
-				perlinizer0(buffer, phasorBuf, scl.data(), sclInv.data(),
-					noise.data(), noiseSizeF, phaseOffset, numSamples, octFloorBuf.data());
-				perlinizer1(buffer, phasorBuf, scl.data(), sclInv.data(),
-					noise.data(), noiseSizeF, phaseOffset, numSamples, octCeilBuf.data(), octBuf);
+				static juce::CriticalSection mutex;
+				static std::array<std::shared_ptr<const Cells>, NumLanes + 1> sharedCells;
+
+				const juce::ScopedLock lock(mutex);
+				auto& sharedC = sharedCells[numOctaves];
+				if (sharedC == nullptr)
+					sharedC = makeCells(1 << numOctaves);
+				return sharedC;
 			}
-		};
 
-		class AudioRate
-		{
-			static constexpr float PBGain = 2.f / static_cast<float>(0x3fff);
-
-			struct Osc
+			static std::shared_ptr<const Cells> makeCells(int noiseSize)
 			{
-				Osc() :
-					phasor()
-				{}
-				void prepare(float sampleRate) noexcept
-				{
-					phasor.prepare(sampleRate);
-				}
-				void setFrequencyHz(float f) noexcept
+				std::vector<float> noise;
+				noise.resize(noiseSize + 4); // + splineSize
+
+				// each entry reseeds the same generator as before the shared cells,
+				// so that saved patches keep sounding the same
+				unsigned int seed = 420 * 69 / 666 * 42;
+				std::mt19937 mt;
+				std::uniform_real_distribution<float> dist(-.89f, .89f); // compensate spline overshoot
+				for (auto s = 0; s < noiseSize; ++s, ++seed)
 				{
-					phasor.setFrequencyHz(f);
+					mt.seed(seed);
+					noise[s] = dist(mt);
 				}
-				float operator()() noexcept
+				for (auto s = noiseSize; s < noise.size(); ++s)
+					noise[s] = noise[s - noiseSize];
+
+				auto cells = std::make_shared<Cells>();
+				for (auto& c : *cells)
+					c.resize(noiseSize);
+				for (auto i = 0; i < noiseSize; ++i)
 				{
-					phasor();
-					return std::cos(approx::Tau * phasor.phase);
+					const auto v0 = noise[i];
+					const auto v1 = noise[i + 1];
+					const auto v2 = noise[i + 2];
+					const auto v3 = noise[i + 3];
+
+					(*cells)[0][i] = v1;
+					(*cells)[1][i] = .5f * (v2 - v0);
+					(*cells)[2][i] = v0 - 2.5f * v1 + 2.f * v2 - .5f * v3;
+					(*cells)[3][i] = 1.5f * (v1 - v2) + .5f * (v3 - v0);
 				}
-				
-				inline float withPhaseOffset(Osc& other, float offset) noexcept
+				return cells;
+			}
+
+			// weight of each octave lane, including gain normalisation and octave crossfade
+			// (1-m) * sum(o<F) / G(F) + m * sum(o<F+1) / G(F+1), with G(k) = sum(o<k) sclInv[o]
+			void updateWeights(int oFloor, float mix) noexcept
+			{
+				if (weightsOct == oFloor && weightsMix == mix)
+					return;
+				weightsOct = oFloor;
+				weightsMix = mix;
+
+				const auto g0 = gainInv[oFloor];
+				const auto g1 = gainInv[oFloor + 1];
+				const auto g = g0 + mix * (g1 - g0);
+				for (auto o = 0; o < NumLanes; ++o)
+					weights[o] = o < oFloor ? sclInv[o] * g : o == oFloor ? sclInv[o] * mix * g1 : 0.f;
+			}
+
+			// all octaves are evaluated in lanes of fixed width without branches,
+			// unused octaves just have a weight of 0
+			void synthesizePerlin(float* buffer, const float* octBuf,
+				uint64_t phaseOffset, int numSamples) noexcept
+			{
+				const auto& c = *cells;
+				const auto c0 = c[0].data();
+				const auto c1 = c[1].data();
+				const auto c2 = c[2].data();
+				const auto c3 = c[3].data();
+
+				alignas(32) LanesIdx idx;
+				alignas(32) Lanes t, y;
+
+				for (auto s = 0; s < numSamples; ++s)
 				{
-					const auto phase = other.phasor.phase + offset;
-					return std::cos(approx::Tau * phase);
+					updateWeights(octFloorBuf[s], octBuf[s]);
+
+					const auto p = posBuf[s];
+					for (auto o = 0; o < NumLanes; ++o)
+					{
+						const auto x = (p << o) + phaseOffset;
+						idx[o] = static_cast<int>(x >> idxShift);
+						t[o] = static_cast<float>((x >> fracShift) & FracMask) * FracScale;
+					}
+					for (auto o = 0; o < NumLanes; ++o)
+					{
+						const auto i = idx[o];
+						y[o] = c0[i] + t[o] * (c1[i] + t[o] * (c2[i] + t[o] * c3[i]));
+					}
+					auto smpl = 0.f;
+					for (auto o = 0; o < NumLanes; ++o)
+						smpl += y[o] * weights[o];
+					buffer[s] = smpl;
 				}
+			}
+		};
 
-				Phasor<float> phasor;
-			};
+		class AudioRate
+		{
+			static constexpr float PBGain = 2.f / static_cast<float>(0x3fff);
 		public:
 			AudioRate(int _numChannels) :
 				retuneSpeedSmooth(),
 				widthSmooth(),
 
 				numChannels(_numChannels),
-				osc(),
+				noteToFreq(),
+				cosTable(),
+				phase(0.f), fsInv(1.f),
 				env(),
 
 				noteValue(0.f), pitchbendValue(0.f),
 
 				noteOffset(0.f), width(0.f), retuneSpeed(0.f),
-				attack(1.f), decay(1.f), sustain(1.f), release(1.f),
 
 				Fs(1.f)
-			{
-				osc.resize(numChannels);
-			}
+			{}
 			void prepare(float sampleRate) noexcept
 			{
 				Fs = sampleRate;
-				for(auto& o: osc)
-					o.prepare(sampleRate);
+				fsInv = 1.f / Fs;
 				env.prepare(Fs);
 				modSys6::Smooth::makeFromDecayInMs(retuneSpeedSmooth, retuneSpeed, Fs);
 				modSys6::Smooth::makeFromDecayInMs(widthSmooth, 10.f, Fs);
@@ -766,96 +1452,70 @@ namespace vibrato
 					retuneSpeed = _retuneSpeed;
 					modSys6::Smooth::makeFromDecayInMs(retuneSpeedSmooth, retuneSpeed, Fs);
 				}
-				attack = _attack;
-				env.attack = attack;
-				decay = _decay;
-				env.decay = decay;
-				release = _release;
-				env.release = release;
-				sustain = _sustain;
-				env.sustain = sustain;
+				env.setParameters(_attack, _decay, _sustain, _release);
+			}
+			void reset() noexcept
+			{
+				phase = 0.f;
+				env.reset();
+				noteValue = pitchbendValue = 0.f;
+				retuneSpeedSmooth.setValue(noteToFreq(noteOffset));
+				widthSmooth.setValue(width);
 			}
 
-			void operator()(Buffer& buffer, const juce::MidiBuffer& midi, int numChannelsOut, int numSamples) noexcept
+			// upFactor maps the midi timestamps to the (oversampled) rate of the buffer
+			void operator()(Buffer& buffer, const MidiEvents& midi, int numChannelsOut, int numSamples, int upFactor) noexcept
 			{
-				auto& bufEnv = buffer[2];
+				auto bufEnv = buffer[2].data();
+				auto bufFreq = buffer[1].data();
 
-				{ // SYNTHESIZE MIDI NOTE VALUES (0-127), PITCHBEND AND ENVELOPE
-					auto& bufNotes = buffer[1];
+				{ // SYNTHESIZE MIDI NOTE VALUES (0-127), PITCHBEND AND ENVELOPE SEGMENTS
 					auto currentValue = noteValue + pitchbendValue;
-					if (midi.isEmpty())
+					auto s = 0;
+					for (const auto& e : midi)
 					{
-						for (auto s = 0; s < numSamples; ++s)
+						if (e.type == MidiEvent::Type::CC)
+							continue;
+						const auto ts = MidiEvents::getTimestamp(e, upFactor, 1, numSamples);
+						if (s < ts)
 						{
-							bufNotes[s] = currentValue;
-							bufEnv[s] = env() * SafetyCoeff;
+							juce::FloatVectorOperations::fill(bufFreq + s, currentValue, ts - s);
+							env(bufEnv + s, ts - s);
+							s = ts;
 						}
-					}	
-					else
-					{
-						auto evt = midi.begin();
-						auto ref = *evt;
-						auto ts = ref.samplePosition;
-						for (auto s = 0; s < numSamples; ++s)
+						switch (e.type)
 						{
-							if (ts > s)
-							{
-								bufNotes[s] = currentValue;
-								bufEnv[s] = env() * SafetyCoeff;
-							}
-							else
-							{
-								bool noteOn = env.noteOn;
-								while (ts == s)
-								{
-									auto msg = ref.getMessage();
-									if (msg.isNoteOn())
-									{
-										noteValue = static_cast<float>(msg.getNoteNumber());
-										currentValue = noteValue + pitchbendValue;
-										noteOn = true;
-										env.retrig();
-									}
-									else if (msg.isNoteOff())
-									{
-										if(static_cast<int>(noteValue) == msg.getNoteNumber())
-											noteOn = false;
-									}
-									else if (msg.isPitchWheel())
-									{
-										const auto pwv = msg.getPitchWheelValue();
-										pitchbendValue = static_cast<float>(pwv) * PBGain - 1.f;
-										currentValue = noteValue + pitchbendValue;
-									}
-									++evt;
-									if (evt == midi.end())
- 										ts = numSamples;
-									else
-									{
-										ref = *evt;
-										ts = ref.samplePosition;
-									}
-								}
-								bufNotes[s] = currentValue;
-								bufEnv[s] = env(noteOn) * SafetyCoeff;
-							}
+						case MidiEvent::Type::NoteOn:
+							noteValue = static_cast<float>(e.number);
+							currentValue = noteValue + pitchbendValue;
+							env.retrig();
+							env.setNoteOn(true);
+							break;
+						case MidiEvent::Type::NoteOff:
+							if (static_cast<int>(noteValue) == e.number)
+								env.setNoteOn(false);
+							break;
+						case MidiEvent::Type::PitchWheel:
+							pitchbendValue = static_cast<float>(e.value) * PBGain - 1.f;
+							currentValue = noteValue + pitchbendValue;
+							break;
+						default:
+							break;
 						}
 					}
-				}
-				{ // ADD OCT+SEMI+FINE SHIFT TO MIDI NOTE VALUE
-					for (auto s = 0; s < numSamples; ++s)
-						buffer[1][s] += noteOffset;
-				}
-				{ // CONVERT MIDI NOTE VALUES TO FREQUENCIES HZ
-					for (auto s = 0; s < numSamples; ++s)
+					if (s < numSamples)
 					{
-						const auto midiN = buffer[1][s];
-						const auto freq = 440.f * std::pow(2.f, (midiN - 69.f) * .083333333333f);
-						buffer[1][s] = juce::jlimit(1.f, 22049.f, freq);
+						juce::FloatVectorOperations::fill(bufFreq + s, currentValue, numSamples - s);
+						env(bufEnv + s, numSamples - s);
 					}
+					juce::FloatVectorOperations::multiply(bufEnv, SafetyCoeff, numSamples);
+				}
+				{ // CONVERT MIDI NOTE VALUES (+OCT+SEMI+FINE SHIFT) TO FREQUENCIES HZ
+					for (auto s = 0; s < numSamples; ++s)
+						bufFreq[s] = noteToFreq(bufFreq[s] + noteOffset);
 				}
 				{ // PROCESS RETUNE SPEED OF OSC (FILTER CUTOFF)
-					retuneSpeedSmooth(buffer[1].data(), numSamples);
+					retuneSpeedSmooth(bufFreq, numSamples);
 				}
 #if DebugAudioRateEnv
 				{ // COPY ENVELOPE ONLY
@@ -864,24 +1524,32 @@ namespace vibrato
 							buffer[ch][s] = bufEnv[s];
 				}
 #else
-				{ // SYNTHESIZE OSCILLATOR
+				{ // SYNTHESIZE PHASE (IN PLACE OF FREQUENCY)
+					for (auto s = 0; s < numSamples; ++s)
+					{
+						phase += bufFreq[s] * fsInv;
+						if (phase >= 1.f)
+							phase -= std::floor(phase);
+						bufFreq[s] = phase;
+					}
+				}
+				{ // SYNTHESIZE OSCILLATOR (CHANNEL 1 OVERWRITES THE PHASE BUFFER)
+					auto buf0 = buffer[0].data();
 					if (numChannelsOut == 1)
 					{
 						for (auto s = 0; s < numSamples; ++s)
-						{
-							const auto freq = buffer[1][s];
-							osc[0].setFrequencyHz(freq);
-							buffer[0][s] = osc[0]() * bufEnv[s];
-						}
+							buf0[s] = cosTable(bufFreq[s]) * bufEnv[s];
 					}
 					else
-					{ // PROCESS STEREO WIDTH
+					{ // PROCESS STEREO WIDTH (PHASE OFFSET)
+						auto buf1 = buffer[1].data();
 						for (auto s = 0; s < numSamples; ++s)
 						{
-							const auto freq = buffer[1][s];
-							osc[0].setFrequencyHz(freq);
-							buffer[0][s] = osc[0]() * bufEnv[s];
-							buffer[1][s] = osc[1].withPhaseOffset(osc[0], widthSmooth(width)) * bufEnv[s];
+							const auto p0 = bufFreq[s];
+							auto p1 = p0 + widthSmooth(width);
+							p1 -= std::floor(p1);
+							buf0[s] = cosTable(p0) * bufEnv[s];
+							buf1[s] = cosTable(p1) * bufEnv[s];
 						}
 					}
 				}
@@ -891,11 +1559,13 @@ namespace vibrato
 			modSys6::Smooth retuneSpeedSmooth, widthSmooth;
 
 			const int numChannels;
-			std::vector<Osc> osc;
+			const NoteToFreq noteToFreq;
+			const CosTable cosTable;
+			float phase, fsInv;
 			EnvGen env;
 			float noteValue, pitchbendValue;
 
-			float noteOffset, width, retuneSpeed, attack, decay, sustain, release;
+			float noteOffset, width, retuneSpeed;
 			float Fs;
 		};
 
@@ -909,7 +1579,7 @@ namespace vibrato
 
 				phasor(),
 				decay(1.f), spin(1.f), freqChance(0.f), freqSmooth(0.f), width(0.f),
-				rand(),
+				rand(), seed(0),
 
 				numChannels(_numChannels),
 
@@ -919,7 +1589,9 @@ namespace vibrato
 				env{ 0.f, 0.f },
 				smooth(),
 				fs(44100.f), dcy(1.f), spinV(420.f)
-			{}
+			{
+				setSeed(0);
+			}
 			void prepare(float sampleRate)
 			{
 				fs = sampleRate;
@@ -961,64 +1633,104 @@ namespace vibrato
 				freqSmooth = _freqSmooth;
 				width = _width;
 			}
+
+			void setSeed(uint64_t _seed) noexcept
+			{
+				seed = _seed;
+				for (auto ch = 0; ch < rand.size(); ++ch)
+					rand[ch].seed(seed, ch);
+			}
+			// restarts the random streams and the impulse responses
+			void reset() noexcept
+			{
+				setSeed(seed);
+				for (auto ch = 0; ch < 2; ++ch)
+				{
+					phasor[ch].phase = 0.f;
+					accel[ch] = speed[ch] = dest[ch] = env[ch] = 0.f;
+					smooth[ch].setValue(0.f);
+				}
+				smoothSmooth.setValue(freqSmooth);
+				widthSmooth.setValue(width);
+			}
+
+			float getBandwidth() const noexcept
+			{
+				return std::max(spin, freqSmooth);
+			}
 			void operator()(Buffer& buffer, int numChannelsOut, int numSamples) noexcept
 			{
-				{ // FILL BUFFERS WITH IMPULSES
-					for (auto ch = 0; ch < numChannelsOut; ++ch)
+				Dropout* drop = this;
+				Buffer* buf = &buffer;
+				processLanes(&drop, &buf, 1, numChannelsOut, numSamples);
+			}
+			// every channel of every dropout is a lane, so that their envelopes and smoothers interleave.
+			// the dropouts must run at the same rate
+			static constexpr int MaxLanes = modSys6::Smooth::MaxLanes / 2;
+			static void processLanes(Dropout* const* drops, Buffer* const* buffers, int numDrops,
+				int numChannelsOut, int numSamples) noexcept
+			{
+				static constexpr int NumLanesMax = modSys6::Smooth::MaxLanes;
+				std::array<float*, NumLanesMax> bufs;
+				std::array<const float*, NumLanesMax> smoothBufs;
+				std::array<modSys6::Smooth*, NumLanesMax> smooths;
+				std::array<float, NumLanesMax> ac, velo, dst, en, spinV, dcy;
+				auto numLanes = 0;
+				for (auto d = 0; d < numDrops; ++d)
+				{
+					auto& drop = *drops[d];
+					auto& buffer = *buffers[d];
+					drop.fillImpulses(buffer, numChannelsOut, numSamples);
+					auto smoothBuf = buffer[2].data();
+					drop.smoothSmooth(smoothBuf, drop.freqSmooth, numSamples);
+					for (auto ch = 0; ch < numChannelsOut; ++ch, ++numLanes)
 					{
-						auto& phasr = phasor[ch];
-						auto impulseBuf = buffer[ch].data();
-						juce::FloatVectorOperations::fill(impulseBuf, 0.f, numSamples);
-						for (auto s = 0; s < numSamples; ++s)
-							if (phasr())
-								impulseBuf[s] = 2.f * (rand.nextFloat() - .5f);
-								
+						bufs[numLanes] = buffer[ch].data();
+						smoothBufs[numLanes] = smoothBuf;
+						smooths[numLanes] = &drop.smooth[ch];
+						ac[numLanes] = drop.accel[ch];
+						velo[numLanes] = drop.speed[ch];
+						dst[numLanes] = drop.dest[ch];
+						en[numLanes] = drop.env[ch];
+						spinV[numLanes] = drop.spinV;
+						dcy[numLanes] = drop.dcy;
 					}
 				}
-				auto smoothBuf = buffer[2].data();
-				{ // PROCESS SMOOTH SMOOTH
-					for (auto s = 0; s < numSamples; ++s)
-						smoothBuf[s] = smoothSmooth(freqSmooth);
-				}
 				{ // SYNTHESIZE MOD
-					for (auto ch = 0; ch < numChannelsOut; ++ch)
-					{
-						auto buf = buffer[ch].data();
-						auto& ac = accel[ch];
-						auto& velo = speed[ch];
-						auto& dst = dest[ch];
-						auto& en = env[ch];
-
-						for (auto s = 0; s < numSamples; ++s)
+					for (auto s = 0; s < numSamples; ++s)
+						for (auto l = 0; l < numLanes; ++l)
 						{
-							auto& smpl = buf[s];
+							auto& smpl = bufs[l][s];
 							if (smpl != 0.f)
 							{
-								en = smpl;
-								dst = 0.f;
-								ac = 0.f;
-								velo = 0.f;
+								en[l] = smpl;
+								dst[l] = 0.f;
+								ac[l] = 0.f;
+								velo[l] = 0.f;
 							}
-							const auto dist = dst - en;
+							const auto dist = dst[l] - en[l];
 							const auto direc = dist < 0.f ? -1.f : 1.f;
 
-							ac = (velo * direc + dist) * spinV;
-							velo += ac;
-							en = (en + velo) * dcy;
-							smpl = en;
-
-							modSys6::Smooth::makeFromDecayInHz(smooth[ch], smoothBuf[s], fs);
-
-							smpl = smooth[ch](smpl);
+							ac[l] = (velo[l] * direc + dist) * spinV[l];
+							velo[l] += ac[l];
+							en[l] = (en[l] + velo[l]) * dcy[l];
+							smpl = en[l];
 						}
-					}
 				}
-				{ // PROCESS WIDTH
-					if (numChannelsOut == 2)
+				modSys6::Smooth::processLanesDecayInHz(smooths.data(), bufs.data(), smoothBufs.data(),
+					numLanes, numSamples, drops[0]->fs);
+				numLanes = 0;
+				for (auto d = 0; d < numDrops; ++d)
+				{
+					auto& drop = *drops[d];
+					for (auto ch = 0; ch < numChannelsOut; ++ch, ++numLanes)
 					{
-						for (auto s = 0; s < numSamples; ++s)
-							buffer[1][s] = buffer[0][s] + widthSmooth(width) * (buffer[1][s] - buffer[0][s]);
+						drop.accel[ch] = ac[numLanes];
+						drop.speed[ch] = velo[numLanes];
+						drop.dest[ch] = dst[numLanes];
+						drop.env[ch] = en[numLanes];
 					}
+					drop.processWidth(*buffers[d], numChannelsOut, numSamples);
 				}
 			}
 		protected:
@@ -1026,22 +1738,49 @@ namespace vibrato
 
 			std::array<Phasor<float>, 2> phasor;
 			float decay, spin, freqChance, freqSmooth, width;
-			juce::Random rand;
+			// one stream per channel
+			std::array<prng::Xoshiro128, 2> rand;
+			uint64_t seed;
 
 			int numChannels;
 
 			std::array<float, 2> accel, speed, dest, env;
 			std::array<modSys6::Smooth, 2> smooth;
 			float fs, dcy, spinV;
+
+			void fillImpulses(Buffer& buffer, int numChannelsOut, int numSamples) noexcept
+			{
+				for (auto ch = 0; ch < numChannelsOut; ++ch)
+				{
+					auto& phasr = phasor[ch];
+					auto impulseBuf = buffer[ch].data();
+					rand[ch].fill(impulseBuf, numSamples, -1.f, 1.f);
+					for (auto s = 0; s < numSamples; ++s)
+						if (!phasr())
+							impulseBuf[s] = 0.f;
+				}
+			}
+			void processWidth(Buffer& buffer, int numChannelsOut, int numSamples) noexcept
+			{
+				if (numChannelsOut == 2)
+					for (auto s = 0; s < numSamples; ++s)
+						buffer[1][s] = buffer[0][s] + widthSmooth(width) * (buffer[1][s] - buffer[0][s]);
+			}
 		};
 
 		struct EnvFol
 		{
-			EnvFol(int _numChannels) :
+			static constexpr float RMSWindowMs = 20.f;
+
+			EnvFol(int _numChannels, const EnvFolSettings& _settings) :
+				settings(_settings),
 				gainSmooth(), widthSmooth(),
 
 				envelope{ 0.f, 0.f },
 				envSmooth(),
+				rmsBuf(), lookBuf(),
+				rmsSum{ 0., 0. },
+				truePeakHistory(),
 				Fs(1.f),
 
 				attackInMs(-1.f), releaseInMs(-1.f), gain(-420.f),
@@ -1049,9 +1788,11 @@ namespace vibrato
 				attackV(1.f), releaseV(1.f), gainV(1.f), widthV(0.f),
 				autogainV(1.f),
 
-				numChannels(_numChannels)
+				mode(EnvFolMode::Peak),
+				numChannels(_numChannels), rmsIdx(0), lookIdx(0)
 			{}
-			void prepare(float sampleRate)
+			// latency: how many samples the vibrato delays the audio
+			void prepare(float sampleRate, int latency)
 			{
 				Fs = sampleRate;
 				modSys6::Smooth::makeFromDecayInMs(gainSmooth, 10.f, Fs);
@@ -1069,6 +1810,16 @@ namespace vibrato
 					updateAutogainV();
 				}
 				updateAutogainV();
+
+				const auto rmsSize = std::max(1, static_cast<int>(std::rint(RMSWindowMs * Fs * .001f)));
+				const auto lookSize = std::max(0, latency) + 1;
+				for (auto ch = 0; ch < 2; ++ch)
+				{
+					rmsBuf[ch].assign(rmsSize, 0.f);
+					lookBuf[ch].assign(lookSize, 0.f);
+				}
+				lookIdx = 0;
+				clearDetectors();
 			}
 			void setParameters(float _attackInMs, float _releaseInMs, float _gain, float _width) noexcept
 			{
@@ -1093,70 +1844,90 @@ namespace vibrato
 				}
 				widthV = _width;
 			}
-			void operator()(Buffer& buffer, const float** samples, int numChannelsIn, int numChannelsOut, int numSamples) noexcept
+			void reset() noexcept
 			{
-				auto gainBuf = buffer[2].data();
-				{ // PROCESS GAIN SMOOTH
-					for (auto s = 0; s < numSamples; ++s)
+				for (auto ch = 0; ch < 2; ++ch)
+				{
+					envelope[ch] = 0.f;
+					envSmooth[ch].setValue(0.f);
+					std::fill(lookBuf[ch].begin(), lookBuf[ch].end(), 0.f);
+				}
+				lookIdx = 0;
+				clearDetectors();
+				gainSmooth.setValue(gainV * autogainV);
+				widthSmooth.setValue(widthV);
+			}
+			// both channels run side by side as lanes of the same loops
+			template<typename Float>
+			void operator()(Buffer& buffer, const AudioInput<Float>& input, int numChannelsOut, int numSamples) noexcept
+			{
+				int numChannelsIn;
+				const auto samples = input.get(settings.sidechain.load(), numChannelsIn);
+				const auto numLanes = numChannelsIn + numChannelsOut == 4 ? 2 : 1;
+				{ // UPDATE MODE
+					const auto m = settings.mode.load();
+					if (mode != m)
 					{
-						gainBuf[s] = gainSmooth(gainV * autogainV);
+						mode = m;
+						clearDetectors();
 					}
 				}
-				{ // SYNTHESIZE ENVELOPE FROM SAMPLES
+				auto gainBuf = buffer[2].data();
+				gainSmooth(gainBuf, gainV * autogainV, numSamples);
+				{ // READ INPUT
+					for (auto ch = 0; ch < numLanes; ++ch)
 					{
-						auto& env = envelope[0];
-						const auto smpls = samples[0];
-						auto buf = buffer[0].data();
-
+						auto buf = buffer[ch].data();
+						const auto smpls = samples[ch];
 						for (auto s = 0; s < numSamples; ++s)
-						{
-							const auto smpl = gainBuf[s] * smpls[s] * smpls[s];
-							if (env < smpl)
-								env += attackV * (smpl - env);
-							else
-								env += releaseV * (smpl - env);
-							buf[s] = env;
-						}
+							buf[s] = static_cast<float>(smpls[s]);
 					}
-					if (numChannelsIn + numChannelsOut == 4)
-					{
-						auto& env = envelope[1];
-						const auto smpls = samples[1];
-						auto buf = buffer[1].data();
-
+					if (!settings.lookahead.load())
+						delayInput(buffer, numLanes, numSamples);
+				}
+				switch (mode)
+				{
+				case EnvFolMode::Peak: detectPeak(buffer, numLanes, numSamples); break;
+				case EnvFolMode::RMS: detectRMS(buffer, numLanes, numSamples); break;
+				case EnvFolMode::TruePeak: detectTruePeak(buffer, numLanes, numSamples); break;
+				default: break;
+				}
+				{ // SYNTHESIZE ENVELOPE FROM LEVEL
+					if (numLanes == 2)
+						synthesizeEnvelopeStereo(buffer[0].data(), buffer[1].data(), gainBuf, numSamples);
+					else
+						synthesizeEnvelope(buffer[0].data(), gainBuf, numSamples);
+				}
+				if (numChannelsOut == 2)
+				{
+					if (numLanes == 2)
+					{ // PROCESS WIDTH
+						auto widthBuf = buffer[3].data();
+						widthSmooth(widthBuf, widthV, numSamples);
 						for (auto s = 0; s < numSamples; ++s)
-						{
-							const auto smpl = gainBuf[s] * smpls[s] * smpls[s];
-							if (env < smpl)
-								env += attackV * (smpl - env);
-							else
-								env += releaseV * (smpl - env);
-							buf[s] = env;
-						}
-
-						{ // PROCESS WIDTH
-							if (numChannelsOut == 2)
-								for (auto s = 0; s < numSamples; ++s)
-									buffer[1][s] = buffer[0][s] + widthSmooth(widthV) * (buffer[1][s] - buffer[0][s]);
-						}
+							buffer[1][s] = buffer[0][s] + widthBuf[s] * (buffer[1][s] - buffer[0][s]);
 					}
+					else
+						juce::FloatVectorOperations::copy(buffer[1].data(), buffer[0].data(), numSamples);
 				}
 				{ // PROCESS ANTI-CLIPPING
 					for (auto ch = 0; ch < numChannelsOut; ++ch)
 					{
 						auto buf = buffer[ch].data();
-						auto& smooth = envSmooth[ch];
-
-						for (auto s = 0; s < numSamples; ++s)
-							buf[s] = smooth(buf[s] < 1.f ? buf[s] : 1.f);
+						juce::FloatVectorOperations::min(buf, buf, 1.f, numSamples);
+						envSmooth[ch](buf, numSamples);
 					}
 				}
 			}
 		protected:
+			const EnvFolSettings& settings;
 			modSys6::Smooth gainSmooth, widthSmooth;
 
 			std::array<float, 2> envelope;
 			std::array<modSys6::Smooth, 2> envSmooth;
+			std::array<std::vector<float>, 2> rmsBuf, lookBuf;
+			std::array<double, 2> rmsSum;
+			std::array<std::array<float, 3>, 2> truePeakHistory;
 			float Fs;
 
 			float attackInMs, releaseInMs, gain;
@@ -1164,12 +1935,150 @@ namespace vibrato
 			float attackV, releaseV, gainV, widthV;
 			float autogainV;
 
-			int numChannels;
+			EnvFolMode mode;
+			int numChannels, rmsIdx, lookIdx;
 
 			void updateAutogainV() noexcept
 			{
 				autogainV = attackV != 0.f ? 1.f + std::sqrt(releaseV / attackV) : 1.f;
 			}
+
+			void synthesizeEnvelope(float* buf, const float* gainBuf, int numSamples) noexcept
+			{
+				auto env = envelope[0];
+				for (auto s = 0; s < numSamples; ++s)
+				{
+					const auto x = gainBuf[s] * buf[s];
+					env += (env < x ? attackV : releaseV) * (x - env);
+					buf[s] = env;
+				}
+				envelope[0] = env;
+			}
+			// both channels' recursions in one loop body, so that they share a 2 lane register
+			void synthesizeEnvelopeStereo(float* buf0, float* buf1, const float* gainBuf, int numSamples) noexcept
+			{
+				const auto atk = attackV;
+				const auto rls = releaseV;
+				auto env0 = envelope[0];
+				auto env1 = envelope[1];
+				for (auto s = 0; s < numSamples; ++s)
+				{
+					const auto x0 = gainBuf[s] * buf0[s];
+					const auto x1 = gainBuf[s] * buf1[s];
+					env0 += (env0 < x0 ? atk : rls) * (x0 - env0);
+					env1 += (env1 < x1 ? atk : rls) * (x1 - env1);
+					buf0[s] = env0;
+					buf1[s] = env1;
+				}
+				envelope = { env0, env1 };
+			}
+
+			void clearDetectors() noexcept
+			{
+				for (auto ch = 0; ch < 2; ++ch)
+				{
+					std::fill(rmsBuf[ch].begin(), rmsBuf[ch].end(), 0.f);
+					rmsSum[ch] = 0.;
+					truePeakHistory[ch].fill(0.f);
+				}
+				rmsIdx = 0;
+			}
+
+			// lets the follower hear the audio when it leaves the vibrato instead of when it enters it
+			void delayInput(Buffer& buffer, int numLanes, int numSamples) noexcept
+			{
+				const auto size = static_cast<int>(lookBuf[0].size());
+				auto idx = lookIdx;
+				for (auto ch = 0; ch < numLanes; ++ch)
+				{
+					auto ring = lookBuf[ch].data();
+					auto buf = buffer[ch].data();
+					idx = lookIdx;
+					for (auto s = 0; s < numSamples; ++s)
+					{
+						ring[idx] = buf[s];
+						++idx;
+						if (idx == size)
+							idx = 0;
+						buf[s] = ring[idx];
+					}
+				}
+				lookIdx = idx;
+			}
+
+			// all detectors measure power, like the squared samples the follower always used
+			void detectPeak(Buffer& buffer, int numLanes, int numSamples) noexcept
+			{
+				for (auto ch = 0; ch < numLanes; ++ch)
+					juce::FloatVectorOperations::multiply(buffer[ch].data(), buffer[ch].data(), numSamples);
+			}
+
+			void detectRMS(Buffer& buffer, int numLanes, int numSamples) noexcept
+			{
+				const auto size = static_cast<int>(rmsBuf[0].size());
+				const auto sizeInv = 1. / static_cast<double>(size);
+				auto idx = rmsIdx;
+				for (auto ch = 0; ch < numLanes; ++ch)
+				{
+					auto ring = rmsBuf[ch].data();
+					auto buf = buffer[ch].data();
+					auto sum = rmsSum[ch];
+					idx = rmsIdx;
+					for (auto s = 0; s < numSamples; ++s)
+					{
+						const auto x2 = buf[s] * buf[s];
+						sum += static_cast<double>(x2) - static_cast<double>(ring[idx]);
+						ring[idx] = x2;
+						++idx;
+						if (idx == size)
+						{
+							// the running sum gets recounted once per window, so rounding can't drift
+							idx = 0;
+							sum = 0.;
+							for (auto i = 0; i < size; ++i)
+								sum += static_cast<double>(ring[i]);
+						}
+						buf[s] = static_cast<float>(std::max(sum, 0.) * sizeInv);
+					}
+					rmsSum[ch] = sum;
+				}
+				rmsIdx = idx;
+			}
+
+			// cubic hermite (catmull-rom) taps for the points at .25, .5 and .75 between v1 and v2
+			static constexpr float TruePeakTaps[3][4] =
+			{
+				{ -.0703125f, .8671875f, .2265625f, -.0234375f },
+				{ -.0625f, .5625f, .5625f, -.0625f },
+				{ -.0234375f, .2265625f, .8671875f, -.0703125f }
+			};
+
+			// catches the peaks between samples from a 4x cubic hermite interpolation, which
+			// runs as 3 fixed 4-tap firs. lags 2 samples. buffer[3] is free while detecting
+			void detectTruePeak(Buffer& buffer, int numLanes, int numSamples) noexcept
+			{
+				auto x = buffer[3].data();
+				for (auto ch = 0; ch < numLanes; ++ch)
+				{
+					auto& h = truePeakHistory[ch];
+					auto buf = buffer[ch].data();
+					{ // THE HISTORY PRECEDES THE BLOCK (THE BUFFERS HAVE ROOM FOR IT)
+						x[0] = h[0];
+						x[1] = h[1];
+						x[2] = h[2];
+						juce::FloatVectorOperations::copy(x + 3, buf, numSamples);
+						h = { x[numSamples], x[numSamples + 1], x[numSamples + 2] };
+					}
+					for (auto s = 0; s < numSamples; ++s)
+					{
+						const auto v0 = x[s], v1 = x[s + 1], v2 = x[s + 2], v3 = x[s + 3];
+						const auto y0 = TruePeakTaps[0][0] * v0 + TruePeakTaps[0][1] * v1 + TruePeakTaps[0][2] * v2 + TruePeakTaps[0][3] * v3;
+						const auto y1 = TruePeakTaps[1][0] * v0 + TruePeakTaps[1][1] * v1 + TruePeakTaps[1][2] * v2 + TruePeakTaps[1][3] * v3;
+						const auto y2 = TruePeakTaps[2][0] * v0 + TruePeakTaps[2][1] * v1 + TruePeakTaps[2][2] * v2 + TruePeakTaps[2][3] * v3;
+						buf[s] = std::max(std::max(v1 * v1, y0 * y0), std::max(y1 * y1, y2 * y2));
+					}
+				}
+			}
 		};
 
 		struct Macro
@@ -1187,13 +2096,42 @@ namespace vibrato
 			{
 				macro = _macro;
 			}
+			void reset() noexcept { smooth.setValue(macro); }
+
+			float getBandwidth() const noexcept
+			{
+				return 1000.f / (approx::Tau * 40.f);
+			}
 			void operator()(Buffer& buffer, int numChannelsOut, int numSamples) noexcept
 			{
-				for (auto s = 0; s < numSamples; ++s)
-					buffer[0][s] = smooth(macro);
+				smooth(buffer[0].data(), macro, numSamples);
 				if (numChannelsOut == 2)
 					juce::FloatVectorOperations::copy(buffer[1].data(), buffer[0].data(), numSamples);
 			}
+			// several macros at once, their smoothers run as interleaved lanes
+			static void processLanes(Macro* const* macros, Buffer* const* buffers, int numLanes,
+				int numChannelsOut, int numSamples) noexcept
+			{
+				std::array<modSys6::Smooth*, modSys6::Smooth::MaxLanes> smooths;
+				std::array<float*, modSys6::Smooth::MaxLanes> bufs;
+				auto numMoving = 0;
+				for (auto l = 0; l < numLanes; ++l)
+				{
+					auto& m = *macros[l];
+					auto buf = (*buffers[l])[0].data();
+					juce::FloatVectorOperations::fill(buf, m.macro, numSamples);
+					if (!m.smooth.isSettled(m.macro))
+					{
+						smooths[numMoving] = &m.smooth;
+						bufs[numMoving] = buf;
+						++numMoving;
+					}
+				}
+				modSys6::Smooth::processLanes(smooths.data(), bufs.data(), numMoving, numSamples);
+				if (numChannelsOut == 2)
+					for (auto l = 0; l < numLanes; ++l)
+						juce::FloatVectorOperations::copy((*buffers[l])[1].data(), (*buffers[l])[0].data(), numSamples);
+			}
 		protected:
 			modSys6::Smooth smooth;
 
@@ -1206,7 +2144,8 @@ namespace vibrato
 		{
 			Pitchbend(int _numChannels) :
 				smooth(),
-				bendV(0.f),
+				fs(1.f),
+				bendV(0.f), smoothRate(1.f),
 				pitchbend(0),
 				numChannels(_numChannels)
 			{}
@@ -1218,45 +2157,57 @@ namespace vibrato
 			{
 				smoothRate = _smoothRate;
 			}
-			void operator()(Buffer& buffer, int numChannelsOut, int numSamples, const juce::MidiBuffer& midiBuffer) noexcept
+			void reset() noexcept
 			{
-				{ // UPDATE MIDI DATA
-					auto s = 0;
-					for (auto midi : midiBuffer)
-					{
-						auto msg = midi.getMessage();
-						if (msg.isPitchWheel())
-						{
-							auto ts = midi.samplePosition;
-							while (s < ts)
-							{
-								buffer[0][s] = bendV;
-								++s;
-							}
-							const auto pb = msg.getPitchWheelValue();
-							if (pitchbend != pb)
-							{
-								pitchbend = pb;
-								static constexpr float PBCoeff = 2.f / static_cast<float>(0x3fff);
-								bendV = static_cast<float>(pitchbend) * PBCoeff - 1.f;
-							}
-						}
-					}
-					while (s < numSamples)
-					{
-						buffer[0][s] = bendV;
-						++s;
-					}
+				bendV = 0.f;
+				pitchbend = 0;
+				smooth.setValue(0.f);
+			}
+
+			float getBandwidth() const noexcept
+			{
+				return 1000.f / (approx::Tau * smoothRate);
+			}
+
+			// decimation maps the midi timestamps to the (control) rate of the buffer
+			void operator()(Buffer& buffer, int numChannelsOut, int numSamples,
+				const MidiEvents& midi, int decimation) noexcept
+			{
+				const auto isConstant = renderBend(buffer[0].data(), numSamples, midi, decimation);
+				{ // SMOOTHING (SKIPPED ONCE SETTLED ON A CONSTANT BEND)
+					smooth.setDecayInMs(smoothRate, fs);
+					if (isConstant)
+						smooth(buffer[0].data(), bendV, numSamples);
+					else
+						smooth(buffer[0].data(), numSamples);
 				}
-				{ // SMOOTHING
-					for (auto s = 0; s < numSamples; ++s)
+				if (numChannelsOut == 2)
+					juce::FloatVectorOperations::copy(buffer[1].data(), buffer[0].data(), numSamples);
+			}
+			// several pitchbends at once, their smoothers run as interleaved lanes
+			static void processLanes(Pitchbend* const* bends, Buffer* const* buffers, int numLanes,
+				int numChannelsOut, int numSamples, const MidiEvents& midi, int decimation) noexcept
+			{
+				std::array<modSys6::Smooth*, modSys6::Smooth::MaxLanes> smooths;
+				std::array<float*, modSys6::Smooth::MaxLanes> bufs;
+				auto numMoving = 0;
+				for (auto l = 0; l < numLanes; ++l)
+				{
+					auto& p = *bends[l];
+					auto buf = (*buffers[l])[0].data();
+					const auto isConstant = p.renderBend(buf, numSamples, midi, decimation);
+					p.smooth.setDecayInMs(p.smoothRate, p.fs);
+					if (!isConstant || !p.smooth.isSettled(p.bendV))
 					{
-						modSys6::Smooth::makeFromDecayInMs(smooth, smoothRate, fs);
-						buffer[0][s] = smooth(buffer[0][s]);
+						smooths[numMoving] = &p.smooth;
+						bufs[numMoving] = buf;
+						++numMoving;
 					}
 				}
+				modSys6::Smooth::processLanes(smooths.data(), bufs.data(), numMoving, numSamples);
 				if (numChannelsOut == 2)
-					juce::FloatVectorOperations::copy(buffer[1].data(), buffer[0].data(), numSamples);
+					for (auto l = 0; l < numLanes; ++l)
+						juce::FloatVectorOperations::copy((*buffers[l])[1].data(), (*buffers[l])[0].data(), numSamples);
 			}
 		protected:
 			modSys6::Smooth smooth;
@@ -1267,126 +2218,177 @@ namespace vibrato
 			int pitchbend;
 
 			int numChannels;
-		};
-		
-		class LFO
-		{
-			using WaveformSmooth = modSys6::Smooth2;
 
-			template<typename Float>
-			struct PhaseSyncronizer
+			// writes the (unsmoothed) bend into buf. returns if it's constant over the block
+			bool renderBend(float* buf, int numSamples, const MidiEvents& midi, int decimation) noexcept
 			{
-				PhaseSyncronizer() :
-					inc(static_cast<Float>(1))
-				{}
-
-				void prepare(Float Fs, Float timeInMs) noexcept
+				auto isConstant = true;
+				auto s = 0;
+				for (const auto& e : midi)
 				{
-					inc = static_cast<Float>(1) / (Fs * timeInMs * static_cast<Float>(.001));
+					if (e.type == MidiEvent::Type::PitchWheel)
+					{
+						const auto ts = MidiEvents::getTimestamp(e, 1, decimation, numSamples);
+						while (s < ts)
+						{
+							buf[s] = bendV;
+							++s;
+						}
+						const auto pb = e.value;
+						if (pitchbend != pb)
+						{
+							pitchbend = pb;
+							static constexpr float PBCoeff = 2.f / static_cast<float>(0x3fff);
+							bendV = static_cast<float>(pitchbend) * PBCoeff - 1.f;
+							if (s != 0)
+								isConstant = false;
+						}
+					}
 				}
-
-				Float operator()(Float curPhase, Float destPhase) const noexcept
+				while (s < numSamples)
 				{
-					const auto dist = destPhase - curPhase;
-					curPhase += inc * dist;
-					return curPhase;
+					buf[s] = bendV;
+					++s;
 				}
-			protected:
-				Float inc;
-			};
+				return isConstant;
+			}
+		};
+		
+		template<typename Float>
+		struct PhaseSyncronizer
+		{
+			PhaseSyncronizer() :
+				inc(static_cast<Float>(1))
+			{}
 
-			struct TempoSync
-			{
-				TempoSync(const BeatsData& _beatsData) :
-					syncer(),
-					phaseSmooth(),
-					transport(),
-					beatsData(_beatsData),
-					fs(1.), extLatency(0.),
-					phasor(0.), inc(0.)
-				{}
-				void prepare(float sampleRate, int latency)
-				{
-					fs = static_cast<double>(sampleRate);
-					extLatency = static_cast<double>(latency);
-					modSys6::Smooth::makeFromDecayInMs(phaseSmooth, 20.f, sampleRate);
-					syncer.prepare(fs, 420.f);
-				}
-				void processTempoSyncStuff(float* buffer, float rateSync, float phase, int numSamples, juce::AudioPlayHead* playHead)
+			void prepare(Float Fs, Float timeInMs) noexcept
+			{
+				inc = static_cast<Float>(1) / (Fs * timeInMs * static_cast<Float>(.001));
+			}
+
+			Float operator()(Float curPhase, Float destPhase) const noexcept
+			{
+				const auto dist = destPhase - curPhase;
+				curPhase += inc * dist;
+				return curPhase;
+			}
+		protected:
+			Float inc;
+		};
+
+		// the phase of tempo synced modulators, follows the host's playhead
+		struct TempoSync
+		{
+			TempoSync(const BeatsData& _beatsData) :
+				syncer(),
+				phaseSmooth(),
+				beatsData(_beatsData),
+				fs(1.), extLatency(0.),
+				phasor(0.), inc(0.)
+			{}
+			void prepare(float sampleRate, int latency)
+			{
+				fs = static_cast<double>(sampleRate);
+				extLatency = static_cast<double>(latency);
+				modSys6::Smooth::makeFromDecayInMs(phaseSmooth, 20.f, sampleRate);
+				syncer.prepare(fs, 420.f);
+			}
+			void processTempoSyncStuff(float* buffer, float rateSync, float phase, int numSamples, const Transport& transport)
+			{
+				if (transport.isPlaying)
 				{
-					const auto canBeSync = playHead->getCurrentPosition(transport) && transport.isPlaying;
-					if (canBeSync)
-					{
-						const auto rateSyncV = static_cast<double>(beatsData[static_cast<int>(rateSync)].val);
-						const auto rateSyncInv = 1. / rateSyncV;
-
-						const auto bpm = transport.bpm;
-						const auto bps = bpm / 60.;
-						const auto quarterNoteLengthInSamples = fs / bps;
-						const auto barLengthInSamples = quarterNoteLengthInSamples * 4.;
-						inc = 1. / (barLengthInSamples * rateSyncV);
-
-						const auto latencyLengthInQuarterNotes = extLatency / quarterNoteLengthInSamples;
-						auto ppq = (transport.ppqPosition - latencyLengthInQuarterNotes) * .25;
-						while (ppq < 0.f)
-							++ppq;
-						const auto ppqCh = ppq * rateSyncInv;
-						
-						auto newPhasor = ppqCh - std::floor(ppqCh);
-						if (newPhasor < phasor)
-							++newPhasor;
-
-						auto phaseV = 0.f;
+					const auto rateSyncV = static_cast<double>(beatsData[static_cast<int>(rateSync)].val);
+					const auto rateSyncInv = 1. / rateSyncV;
+
+					// 1 / bar length in samples, ramped from the last block's tempo
+					const auto incCoeff = 1. / (60. * 4. * fs * rateSyncV);
+					const auto incStart = transport.bpmLast * incCoeff;
+					inc = transport.bpm * incCoeff;
+					const auto incStep = (inc - incStart) / static_cast<double>(numSamples);
+					auto incS = incStart;
+
+					const auto quarterNoteLengthInSamples = fs * 60. / transport.bpm;
+					const auto latencyLengthInQuarterNotes = extLatency / quarterNoteLengthInSamples;
+					auto ppq = (transport.ppq - latencyLengthInQuarterNotes) * .25;
+					while (ppq < 0.f)
+						++ppq;
+					const auto ppqCh = ppq * rateSyncInv;
+					
+					auto newPhasor = ppqCh - std::floor(ppqCh);
+					if (newPhasor < phasor)
+						++newPhasor;
 
-						for (auto s = 0; s < numSamples; ++s)
-						{
-							phasor += inc;
-							phasor = syncer(phasor, newPhasor);
-							newPhasor += inc;
-
-							phaseV = static_cast<double>(phaseSmooth(phase));
-							auto shifted = phasor + phaseV;
-							while (shifted < 0.)
-								++shifted;
-							while (shifted >= 1.)
-								--shifted;
-							buffer[s] = shifted;
-						}
+					auto phaseV = 0.f;
 
-						const auto p = buffer[numSamples - 1] - phaseV;
-						phasor = p < 0.f ? p + 1.f : p >= 1.f ? p - 1.f : p;
+					for (auto s = 0; s < numSamples; ++s)
+					{
+						incS += incStep;
+						phasor += incS;
+						phasor = syncer(phasor, newPhasor);
+						newPhasor += incS;
+
+						phaseV = static_cast<double>(phaseSmooth(phase));
+						auto shifted = phasor + phaseV;
+						while (shifted < 0.)
+							++shifted;
+						while (shifted >= 1.)
+							--shifted;
+						buffer[s] = shifted;
 					}
-					else
+
+					const auto p = buffer[numSamples - 1] - phaseV;
+					phasor = p < 0.f ? p + 1.f : p >= 1.f ? p - 1.f : p;
+				}
+				else
+				{
+					for (auto s = 0; s < numSamples; ++s)
 					{
-						for (auto s = 0; s < numSamples; ++s)
-						{
-							phasor += inc;
-							if (phasor >= 1.f)
-								--phasor;
-							const auto phaseV = static_cast<double>(phaseSmooth(phase));
-							auto shifted = phasor + phaseV;
-							if (shifted < 0.)
-								++shifted;
-							else if (shifted >= 1.)
-								--shifted;
-							buffer[s] = shifted;
-						}
+						phasor += inc;
+						if (phasor >= 1.f)
+							--phasor;
+						const auto phaseV = static_cast<double>(phaseSmooth(phase));
+						auto shifted = phasor + phaseV;
+						if (shifted < 0.)
+							++shifted;
+						else if (shifted >= 1.)
+							--shifted;
+						buffer[s] = shifted;
 					}
 				}
-			protected:
-				PhaseSyncronizer<double> syncer;
-				modSys6::Smooth phaseSmooth;
-				juce::AudioPlayHead::CurrentPositionInfo transport;
-				const BeatsData& beatsData;
-				double fs, extLatency, phasor, inc;
-			};
+			}
+
+			void reset(float phase) noexcept
+			{
+				phasor = inc = 0.;
+				phaseSmooth.setValue(phase);
+			}
+
+			double getInc() const noexcept { return inc; }
+		protected:
+			PhaseSyncronizer<double> syncer;
+			modSys6::Smooth phaseSmooth;
+			const BeatsData& beatsData;
+			double fs, extLatency, phasor, inc;
+		};
+
+		class LFO
+		{
+			static constexpr int NumMorphStages = 4;
+			static constexpr float TableSizeF = static_cast<float>(LFOTableSize);
+
 		public:
-			LFO(int _numChannels, const Tables& _tables, const BeatsData& _beatsData) :
-				tables(_tables),
+			LFO(int _numChannels, const BeatsData& _beatsData) :
+				tables(nullptr),
 				tempoSync(_beatsData),
 
-				waveformSmooth(false, 4),
+				morphTable(),
+				morphStages(),
+				morphX(0.f), morphTableV(-1.f),
+				morphTablePtr(nullptr),
+				morphTableMip(-1), morphTableVersion(-1),
 				widthSmooth(),
+
+				fs(1.f), fsInv(1.f),
 				
 				rateFree(-1.f),
 				isSync(false),
@@ -1399,10 +2401,11 @@ namespace vibrato
 			{}
 			void prepare(float sampleRate, int latency)
 			{
-				const auto fs = sampleRate;
+				fs = sampleRate;
 				fsInv = 1.f / fs;
 				tempoSync.prepare(sampleRate, latency);
-				waveformSmooth.makeFromDecayInMs(500.f, fs);
+				morphTable.resize(LFOTableSize + 1, 0.f);
+				morphX = std::exp(-1.f / (500.f * fs * .001f));
 				modSys6::Smooth::makeFromDecayInMs(widthSmooth, 20.f, fs);
 				modSys6::Smooth::makeFromDecayInMs(rateSmooth, 12.f, fs);
 			}
@@ -1415,58 +2418,102 @@ namespace vibrato
 				phaseV = _phase;
 				widthV = _width;
 			}
-			void operator()(Buffer& buffer, int numChannelsOut, int numSamples, juce::AudioPlayHead* playHead) noexcept
+			void reset() noexcept
+			{
+				tempoSync.reset(phaseV);
+				phasor.phase = 0.;
+				rateSmooth.setValue(rateFree);
+				widthSmooth.setValue(widthV);
+				morphStages.fill(waveformV);
+			}
+
+			// the waveforms' harmonics reach far above the rate itself
+			float getBandwidth() const noexcept
 			{
-				bool canBeSync = playHead != nullptr;
+				static constexpr float NumHarmonics = 32.f;
+				const auto rate = isSync ? static_cast<float>(getInc()) * fs : rateFree;
+				return rate * NumHarmonics;
+			}
+
+			void operator()(Buffer& buffer, int numChannelsOut, int numSamples, const Transport& transport) noexcept
+			{
+				LFO* lfo = this;
+				Buffer* buf = &buffer;
+				processLanes(&lfo, &buf, 1, numChannelsOut, numSamples, transport);
+			}
+			// the free running phasors of several lfos run side by side in lanes,
+			// each one with its rate smoother. the lfos must run at the same rate
+			static void processLanes(LFO* const* lfos, Buffer* const* buffers, int numLFOs,
+				int numChannelsOut, int numSamples, const Transport& transport) noexcept
+			{
+				static constexpr int MaxLanes = modSys6::Smooth::MaxLanes;
+				std::array<LFO*, MaxLanes> freeLFOs;
+				std::array<modSys6::Smooth*, MaxLanes> smooths;
+				std::array<float*, MaxLanes> bufs;
+				auto numLanes = 0;
 				{ // SYNTHESIZE PHASOR
-					if (isSync && canBeSync)
+					const auto canBeSync = transport.hasPlayHead;
+					for (auto i = 0; i < numLFOs; ++i)
 					{
-						auto buf = buffer[0].data();
-						tempoSync.processTempoSyncStuff(buf, rateSync, phaseV, numSamples, playHead);
-					}
-					else
-					{
-						auto buf = buffer[0].data();
-						for (auto s = 0; s < numSamples; ++s)
+						auto& lfo = *lfos[i];
+						auto buf = (*buffers[i])[0].data();
+						if (lfo.isSync && canBeSync)
+							lfo.tempoSync.processTempoSyncStuff(buf, lfo.rateSync, lfo.phaseV, numSamples, transport);
+						else
 						{
-							phasor.inc = rateSmooth(rateFree) * fsInv;
-							buf[s] = static_cast<float>(phasor.process());
+							juce::FloatVectorOperations::fill(buf, lfo.rateFree, numSamples);
+							freeLFOs[numLanes] = &lfo;
+							smooths[numLanes] = &lfo.rateSmooth;
+							bufs[numLanes] = buf;
+							++numLanes;
 						}
-							
 					}
-				}
-				{ // PROCESS WIDTH
-					if (numChannelsOut == 2)
+					modSys6::Smooth::processLanes(smooths.data(), bufs.data(), numLanes, numSamples);
+					std::array<double, MaxLanes> phase, inc;
+					std::array<float, MaxLanes> fsInv;
+					for (auto l = 0; l < numLanes; ++l)
 					{
-						const auto buf0 = buffer[0].data();
-						auto buf1 = buffer[1].data();
-						juce::FloatVectorOperations::copy(buf1, buf0, numSamples);
-						for (auto s = 0; s < numSamples; ++s)
+						phase[l] = freeLFOs[l]->phasor.phase;
+						inc[l] = freeLFOs[l]->phasor.inc;
+						fsInv[l] = freeLFOs[l]->fsInv;
+					}
+					for (auto s = 0; s < numSamples; ++s)
+						for (auto l = 0; l < numLanes; ++l)
 						{
-							buf1[s] = buf0[s] + widthSmooth(widthV);
-							if (buf1[s] >= 1.f)
-								--buf1[s];
+							inc[l] = bufs[l][s] * fsInv[l];
+							phase[l] += inc[l];
+							if (phase[l] >= 1.)
+								--phase[l];
+							bufs[l][s] = static_cast<float>(phase[l]);
 						}
-					}
-				}
-				{ // PROCESS WAVEFORM
-					for (auto ch = 0; ch < numChannelsOut; ++ch)
+					for (auto l = 0; l < numLanes; ++l)
 					{
-						auto buf = buffer[ch].data();
-						for (auto s = 0; s < numSamples; ++s)
-							buf[s] = tables(waveformSmooth(waveformV), buf[s]) * SafetyCoeff;
+						freeLFOs[l]->phasor.phase = phase[l];
+						freeLFOs[l]->phasor.inc = inc[l];
 					}
 				}
+				for (auto i = 0; i < numLFOs; ++i)
+				{
+					lfos[i]->processWidth(*buffers[i], numChannelsOut, numSamples);
+					lfos[i]->processWaveform(*buffers[i], numChannelsOut, numSamples);
+				}
 			}
+			// the tables must stay alive until the next call
+			void setTables(const Tables* t) noexcept { tables = t; }
 		protected:
-			const Tables& tables;
+			const Tables* tables;
 			TempoSync tempoSync;
-			WaveformSmooth waveformSmooth;
+			// waveform morph of the whole block, blended into one table
+			std::vector<float> morphTable;
+			std::array<double, NumMorphStages> morphStages;
+			float morphX, morphTableV;
+			const Tables* morphTablePtr;
+			int morphTableMip, morphTableVersion;
 			modSys6::Smooth widthSmooth, rateSmooth;
 
 			Phasor<double> phasor;
 
-			float fsInv;
+			float fs, fsInv;
 
 			float rateFree, rateSync;
 			bool isSync;
@@ -1474,6 +2521,96 @@ namespace vibrato
 			float waveformV, phaseV, widthV;
 
 			int numChannels;
+
+			void processWidth(Buffer& buffer, int numChannelsOut, int numSamples) noexcept
+			{
+				if (numChannelsOut == 2)
+				{
+					const auto buf0 = buffer[0].data();
+					auto buf1 = buffer[1].data();
+					juce::FloatVectorOperations::copy(buf1, buf0, numSamples);
+					for (auto s = 0; s < numSamples; ++s)
+					{
+						buf1[s] = buf0[s] + widthSmooth(widthV);
+						if (buf1[s] >= 1.f)
+							--buf1[s];
+					}
+				}
+			}
+			void processWaveform(Buffer& buffer, int numChannelsOut, int numSamples) noexcept
+			{
+				updateMorph(numSamples);
+				const auto table = morphTable.data();
+				for (auto ch = 0; ch < numChannelsOut; ++ch)
+				{
+					auto buf = buffer[ch].data();
+					for (auto s = 0; s < numSamples; ++s)
+					{
+						const auto x = buf[s] * TableSizeF;
+						const auto i = static_cast<int>(x);
+						const auto frac = x - static_cast<float>(i);
+						buf[s] = (table[i] + frac * (table[i + 1] - table[i])) * SafetyCoeff;
+					}
+				}
+			}
+
+			// phase increment per sample, picks the band-limited mip
+			double getInc() const noexcept
+			{
+				return isSync ? tempoSync.getInc() : phasor.inc;
+			}
+
+			// advances the morph smoothing (4 cascaded one-poles) by a whole block at once. the target holds
+			// still during the block, so the cascade's exact n-step response makes the curve independent
+			// of the block size. the blended table only gets rebuilt if the morph position or the mip changed
+			void updateMorph(int numSamples) noexcept
+			{
+				const auto target = static_cast<double>(waveformV);
+				const auto a = static_cast<double>(morphX);
+				const auto n = static_cast<double>(numSamples);
+				// how much of a stage's distance to the target reaches the stage m steps down the cascade:
+				// a^n * (1 - a)^m * binomial(n + m - 1, m)
+				std::array<double, NumMorphStages> weights;
+				weights[0] = std::pow(a, n);
+				for (auto m = 1; m < NumMorphStages; ++m)
+					weights[m] = weights[m - 1] * (1. - a) * (n + static_cast<double>(m - 1)) / static_cast<double>(m);
+				std::array<double, NumMorphStages> dist;
+				for (auto k = 0; k < NumMorphStages; ++k)
+					dist[k] = morphStages[k] - target;
+				auto settled = true;
+				for (auto k = 0; k < NumMorphStages; ++k)
+				{
+					auto d = 0.;
+					for (auto j = 0; j <= k; ++j)
+						d += dist[j] * weights[k - j];
+					morphStages[k] = target + d;
+					settled = settled && std::abs(d) < 1e-5;
+				}
+				// snapping only the whole cascade keeps it independent of the block size
+				if (settled)
+					morphStages.fill(target);
+				const auto x = static_cast<float>(morphStages[NumMorphStages - 1]);
+				const auto morph = juce::jlimit(0.f, 1.f, x);
+
+				const auto mip = Tables::getMip(static_cast<float>(getInc()));
+				if (morph == morphTableV && mip == morphTableMip && tables == morphTablePtr && tables->version == morphTableVersion)
+					return;
+				morphTableV = morph;
+				morphTableMip = mip;
+				morphTablePtr = tables;
+				morphTableVersion = tables->version;
+
+				static constexpr int MaxTable = LFONumTables - 1;
+				const auto tablesX = morph * static_cast<float>(MaxTable);
+				const auto i0 = std::min(static_cast<int>(tablesX), MaxTable - 1);
+				const auto frac = tablesX - static_cast<float>(i0);
+				const auto t0 = tables->getTable(mip, i0).data();
+				const auto t1 = tables->getTable(mip, i0 + 1).data();
+
+				const auto table = morphTable.data();
+				juce::FloatVectorOperations::multiply(table, t0, 1.f - frac, LFOTableSize + 1);
+				juce::FloatVectorOperations::addWithMultiply(table, t1, frac, LFOTableSize + 1);
+			}
 			/*
 			void processTempoSyncStuff(float* buffer, int numSamples)
 			{
@@ -1501,24 +2638,193 @@ namespace vibrato
 			*/
 		};
 
+		// plays a curve file. free running it goes at the curve's own rate times speed,
+		// synced the whole curve gets stretched over rateSync bars.
+		// width offsets the right channel's read head by a fraction of the curve's length
+		class Curve
+		{
+		public:
+			Curve(int _numChannels, const BeatsData& _beatsData) :
+				curve(nullptr),
+				tempoSync(_beatsData),
+				phasor(0.),
+				widthSmooth(), speedSmooth(),
+				fs(1.f), fsInv(1.f),
+				speedV(1.f), rateSync(0.f), widthV(0.f),
+				isSync(false),
+				numChannels(_numChannels)
+			{}
+			void prepare(float sampleRate, int latency)
+			{
+				fs = sampleRate;
+				fsInv = 1.f / fs;
+				tempoSync.prepare(sampleRate, latency);
+				modSys6::Smooth::makeFromDecayInMs(widthSmooth, 20.f, fs);
+				modSys6::Smooth::makeFromDecayInMs(speedSmooth, 12.f, fs);
+			}
+			void setParameters(bool _isSync, float _speed, float _rateSync, float _width) noexcept
+			{
+				isSync = _isSync;
+				speedV = _speed;
+				rateSync = _rateSync;
+				widthV = _width;
+			}
+			void reset() noexcept
+			{
+				tempoSync.reset(0.f);
+				phasor = 0.;
+				speedSmooth.setValue(speedV);
+				widthSmooth.setValue(widthV);
+			}
+
+			// the curve's nyquist at the speed it's played back with
+			float getBandwidth() const noexcept
+			{
+				if (curve == nullptr)
+					return 0.f;
+				const auto framesPerSec = isSync ?
+					static_cast<float>(tempoSync.getInc()) * fs * static_cast<float>(curve->getNumFrames()) :
+					speedV * curve->getSampleRate();
+				return .5f * framesPerSec;
+			}
+
+			void operator()(Buffer& buffer, int numChannelsOut, int numSamples, const Transport& transport) noexcept
+			{
+				if (curve == nullptr)
+				{
+					for (auto ch = 0; ch < numChannelsOut; ++ch)
+						juce::FloatVectorOperations::clear(buffer[ch].data(), numSamples);
+					return;
+				}
+				{ // SYNTHESIZE PHASOR
+					auto buf = buffer[0].data();
+					if (isSync && transport.hasPlayHead)
+						tempoSync.processTempoSyncStuff(buf, rateSync, 0.f, numSamples, transport);
+					else
+					{
+						const auto incCoeff = static_cast<double>(curve->getSampleRate() * fsInv)
+							/ static_cast<double>(curve->getNumFrames());
+						for (auto s = 0; s < numSamples; ++s)
+						{
+							phasor += static_cast<double>(speedSmooth(speedV)) * incCoeff;
+							if (phasor >= 1.)
+								--phasor;
+							buf[s] = static_cast<float>(phasor);
+						}
+					}
+				}
+				{ // PROCESS WIDTH
+					if (numChannelsOut == 2)
+					{
+						const auto buf0 = buffer[0].data();
+						auto buf1 = buffer[1].data();
+						for (auto s = 0; s < numSamples; ++s)
+						{
+							buf1[s] = buf0[s] + widthSmooth(widthV);
+							if (buf1[s] >= 1.f)
+								--buf1[s];
+						}
+					}
+				}
+				{ // READ CURVE
+					const auto& crv = *curve;
+					const auto numFrames = crv.getNumFrames();
+					const auto numFramesF = static_cast<float>(numFrames);
+					const auto wrap = [numFrames](int i) noexcept
+					{
+						return i < 0 ? i + numFrames : i >= numFrames ? i - numFrames : i;
+					};
+					for (auto ch = 0; ch < numChannelsOut; ++ch)
+					{
+						const auto crvCh = std::min(ch, crv.getNumChannels() - 1);
+						auto buf = buffer[ch].data();
+						for (auto s = 0; s < numSamples; ++s)
+						{
+							const auto x = buf[s] * numFramesF;
+							const auto i = static_cast<int>(x);
+							const auto t = x - static_cast<float>(i);
+							const auto v0 = crv(crvCh, wrap(i - 1));
+							const auto v1 = crv(crvCh, wrap(i));
+							const auto v2 = crv(crvCh, wrap(i + 1));
+							const auto v3 = crv(crvCh, wrap(i + 2));
+							const auto c1 = .5f * (v2 - v0);
+							const auto c2 = v0 - 2.5f * v1 + 2.f * v2 - .5f * v3;
+							const auto c3 = 1.5f * (v1 - v2) + .5f * (v3 - v0);
+							buf[s] = (((c3 * t + c2) * t + c1) * t + v1) * SafetyCoeff;
+						}
+					}
+				}
+			}
+			// the curve must stay alive until the next call
+			void setCurve(const curveFile::Curve* c) noexcept { curve = c; }
+		protected:
+			const curveFile::Curve* curve;
+			TempoSync tempoSync;
+			double phasor;
+			modSys6::Smooth widthSmooth, speedSmooth;
+			float fs, fsInv;
+			float speedV, rateSync, widthV;
+			bool isSync;
+			int numChannels;
+		};
+
+		// holds exactly one engine, its index is its ModType
+		using Engine = std::variant<Perlin, AudioRate, Dropout, EnvFol, Macro, Pitchbend, LFO, Curve>;
+		static_assert(std::variant_size_v<Engine> == static_cast<size_t>(ModType::NumMods));
+		// an engine together with the decimation it was prepared at
+		struct PreparedEngine
+		{
+			template<typename T, typename... Args>
+			PreparedEngine(std::in_place_type_t<T> t, Args&&... args) :
+				engine(t, std::forward<Args>(args)...),
+				decimation(1)
+			{}
+
+			Engine engine;
+			int decimation;
+		};
+		// how long switching engines fades from the old engine's last output into the new one
+		static constexpr float EngineFadeMs = 30.f;
+
 	public:
-		Modulator(int _numChannels, const BeatsData& beatsData) :
+		// worker serves the modulator's requests, see processRequests
+		Modulator(int _numChannels, const BeatsData& _beatsData, juce::Thread& worker) :
 			buffer(),
 			numChannels(_numChannels == 1 ? 1 : 2),
 
-			tables(),
-
-			perlin(numChannels, 8),
-			audioRate(numChannels),
-			dropout(numChannels),
-			envFol(numChannels),
-			macro(numChannels),
-			pitchbend(numChannels),
-			lfo(numChannels, tables, beatsData),
-			
-			type(ModType::Perlin)
+			ctrlBuffer(),
+			upsampler(),
+			lastValues{ 0.f, 0.f },
+			Fs(1.f),
+			maxBlockSize(0), latency(0), highRateFactor(1),
+			decimationType(ModType::NumMods),
+			blockDecimation(1),
+			constant(false),
+
+			tablesBuilder(TableType::Weierstrasz, worker),
+			tablesPtr(nullptr),
+
+			envFolSettings(),
+			curveLoader(worker),
+			curvePtr(nullptr),
+
+			beatsData(_beatsData),
+			requestMutex(),
+			prepareMutex(),
+			requestedType(-1),
+			perlinSeed(0), dropoutSeed(0),
+			seedVersion(0), seedVersionApplied(0),
+			bandwidths(),
+			engines(makeEngine(ModType::Perlin)),
+			enginePtr(engines.updateAndLoadCurrentPtr()),
+			engine(&enginePtr->engine),
+			type(ModType::Perlin),
+			engineIsFresh(false),
+			fadeFrom{ 0.f, 0.f },
+			fadeIdx(0), fadeLength(0)
 		{
-			tables.makeTablesWeierstrasz();
+			for (auto& b : bandwidths)
+				b.store(-1.f);
 		}
 
 		void loadPatch(juce::ValueTree& state, int mIdx)
@@ -1529,11 +2835,35 @@ namespace vibrato
 			{
 				const auto tableType = child.getProperty(id);
 				if (tableType == toString(TableType::Weierstrasz))
-					tables.makeTablesWeierstrasz();
+					tablesBuilder.requestTables(TableType::Weierstrasz);
 				else if (tableType == toString(TableType::Tri))
-					tables.makeTablesTriangles();
+					tablesBuilder.requestTables(TableType::Tri);
 				else if (tableType == toString(TableType::Sinc))
-					tables.makeTablesSinc();
+					tablesBuilder.requestTables(TableType::Sinc);
+				else if (tableType == toString(TableType::User))
+					tablesBuilder.requestUserTables(
+						juce::File(child.getProperty("file").toString()),
+						static_cast<uint64_t>(child.getProperty("hash").toString().getHexValue64())
+					);
+			}
+			const juce::Identifier envFolID(with(ObjType::EnvFol, mIdx));
+			const auto envFolChild = state.getChildWithName(envFolID);
+			if (envFolChild.isValid())
+			{
+				envFolSettings.mode.store(getEnvFolMode(envFolChild.getProperty("mode").toString()));
+				envFolSettings.lookahead.store(static_cast<bool>(envFolChild.getProperty("lookahead", true)));
+				envFolSettings.sidechain.store(static_cast<bool>(envFolChild.getProperty("sidechain", false)));
+			}
+			const juce::Identifier curveID(with(ObjType::Curve, mIdx));
+			const auto curveChild = state.getChildWithName(curveID);
+			if (curveChild.isValid())
+			{
+				const auto curveFile = curveChild.getProperty("file").toString();
+				if (curveFile.isNotEmpty())
+					curveLoader.requestCurve(
+						juce::File(curveFile),
+						static_cast<uint64_t>(curveChild.getProperty("hash").toString().getHexValue64())
+					);
 			}
 		}
 		void savePatch(juce::ValueTree& state, int mIdx)
@@ -1545,83 +2875,686 @@ namespace vibrato
 				child = juce::ValueTree(id);
 				state.appendChild(child, nullptr);
 			}
-			child.setProperty(id, tables.name, nullptr);
+			const auto tableType = tablesBuilder.getType();
+			child.setProperty(id, toString(tableType), nullptr);
+			if (tableType == TableType::User)
+			{
+				child.setProperty("file", tablesBuilder.getUserFile().getFullPathName(), nullptr);
+				child.setProperty("hash", juce::String::toHexString(static_cast<juce::int64>(tablesBuilder.getUserHash())), nullptr);
+			}
+			const juce::Identifier envFolID(with(ObjType::EnvFol, mIdx));
+			auto envFolChild = state.getChildWithName(envFolID);
+			if (!envFolChild.isValid())
+			{
+				envFolChild = juce::ValueTree(envFolID);
+				state.appendChild(envFolChild, nullptr);
+			}
+			envFolChild.setProperty("mode", toString(envFolSettings.mode.load()), nullptr);
+			envFolChild.setProperty("lookahead", envFolSettings.lookahead.load(), nullptr);
+			envFolChild.setProperty("sidechain", envFolSettings.sidechain.load(), nullptr);
+			const juce::Identifier curveID(with(ObjType::Curve, mIdx));
+			auto curveChild = state.getChildWithName(curveID);
+			if (!curveChild.isValid())
+			{
+				curveChild = juce::ValueTree(curveID);
+				state.appendChild(curveChild, nullptr);
+			}
+			curveChild.setProperty("file", curveLoader.getFile().getFullPathName(), nullptr);
+			curveChild.setProperty("hash", juce::String::toHexString(static_cast<juce::int64>(curveLoader.getHash())), nullptr);
+		}
+
+		// any thread but the audio thread. only the engine of the requested type gets built,
+		// by buildRequestedEngine, and the audio thread swaps it in with updateEngine
+		void requestType(ModType t) noexcept { requestedType.store(static_cast<int>(t)); }
+
+		// worker thread, or the message thread when a patch must be live right away. builds a requested
+		// engine and serves the lfo's tables and the curve, so that one thread per instance does all the building
+		void processRequests()
+		{
+			const juce::ScopedLock lock(requestMutex);
+			buildRequestedEngine();
+			tablesBuilder.process(typeOf(engines.loadUpdatedPtr()->engine) == ModType::LFO);
+			curveLoader.process();
+		}
+		// audio thread, once per block before setting the parameters.
+		// picks up a newly built engine and fades over to it from the last output
+		ModType updateEngine() noexcept
+		{
+			auto e = engines.updateAndLoadCurrentPtr();
+			if (e != enginePtr)
+			{
+				enginePtr = e;
+				engine = &enginePtr->engine;
+				type = typeOf(*engine);
+				engineIsFresh = true;
+				// it's already prepared at this decimation
+				decimationType = type;
+				upsampler.reset(enginePtr->decimation, lastValues.data(), numChannels);
+				fadeFrom = lastValues;
+				fadeLength = static_cast<int>(Fs * EngineFadeMs * .001f) * getRateFactor();
+				fadeIdx = 0;
+			}
+			const auto version = seedVersion.load();
+			if (version != seedVersionApplied)
+			{
+				seedVersionApplied = version;
+				applySeed(*engine);
+			}
+			return type;
 		}
 
-		void setType(ModType t) noexcept { type = t; }
+		// every random source of the modulator derives from seed. stream tells modulators apart.
+		// the audio thread applies it in updateEngine
+		void setSeed(uint64_t seed, int stream) noexcept
+		{
+			auto x = seed ^ static_cast<uint64_t>(stream);
+			perlinSeed.store(prng::splitMix64(x));
+			dropoutSeed.store(prng::splitMix64(x));
+			++seedVersion;
+		}
+		// puts the engine into the same state as after loading the patch into a new instance,
+		// so that offline renders are bit-exact. call after setting the parameters
+		void reset() noexcept
+		{
+			resetEngine();
+			lastValues = { 0.f, 0.f };
+			upsampler.reset(1, lastValues.data(), numChannels);
+			decimationType = ModType::NumMods;
+			constant = false;
+			fadeIdx = fadeLength = 0;
+		}
 		
-		void prepare(float sampleRate, int maxBlockSize, int latency)
+		// how many floats prepare() needs for the buffers
+		static int getMemorySize(int _maxBlockSize, int _highRateFactor) noexcept
 		{
-			for(auto& b: buffer)
-				b.resize(maxBlockSize + 4, 0.f); // compensate for potential spline interpolation
-			perlin.prepare(sampleRate, maxBlockSize);
-			audioRate.prepare(sampleRate);
-			dropout.prepare(sampleRate);
-			envFol.prepare(sampleRate);
-			macro.prepare(sampleRate);
-			pitchbend.prepare(sampleRate);
-			lfo.prepare(sampleRate, latency);
+			return NumBufferChannels * (getBufferSize(_maxBlockSize, _highRateFactor) + getBufferSize(_maxBlockSize, 1));
+		}
+
+		// sampleRate is the host's rate, high rate types (audiorate) run highRateFactor times faster.
+		// mem must hold getMemorySize() floats and outlive the next prepare
+		void prepare(float sampleRate, int _maxBlockSize, int _latency, int _highRateFactor, float* mem)
+		{
+			const juce::SpinLock::ScopedLockType lock(prepareMutex);
+			Fs = sampleRate;
+			maxBlockSize = _maxBlockSize;
+			latency = _latency;
+			highRateFactor = _highRateFactor;
+			{ // POINT THE BUFFERS INTO MEM
+				const auto bufSize = getBufferSize(maxBlockSize, highRateFactor);
+				const auto ctrlSize = getBufferSize(maxBlockSize, 1);
+				for (auto ch = 0; ch < NumBufferChannels; ++ch)
+				{
+					buffer[ch].ptr = mem + ch * bufSize;
+					ctrlBuffer[ch].ptr = mem + NumBufferChannels * bufSize + ch * ctrlSize;
+				}
+			}
+			{ // ONLY THE NEWEST PUBLISHED ENGINE GETS PREPARED AND GOES LIVE RIGHT AWAY
+				// this can run on the audio thread (oversampling changes), so nothing gets built here
+				auto e = engines.updateAndLoadCurrentPtr();
+				e->decimation = getTargetDecimation(e->engine);
+				prepareEngine(e->engine, e->decimation);
+				if (e != enginePtr)
+				{
+					enginePtr = e;
+					engine = &enginePtr->engine;
+					type = typeOf(*engine);
+					engineIsFresh = true;
+				}
+				decimationType = type;
+				upsampler.reset(e->decimation, lastValues.data(), numChannels);
+				fadeIdx = fadeLength = 0;
+			}
 		}
 
 		// parameters
 		void setParametersPerlin(float rate, float octaves, float width) noexcept
 		{
-			perlin.setParameters(rate, octaves, width);
+			if (auto e = std::get_if<Perlin>(engine))
+				e->setParameters(rate, octaves, width);
 		}
 		void setParametersAudioRate(float oct, float semi, float fine, float width, float retuneSpeed,
 			float attack, float decay, float sustain, float release) noexcept
 		{
 			const auto noteOffset = oct + semi + fine;
-			audioRate.setParameters(noteOffset, width, retuneSpeed, attack, decay, sustain, release);
+			if (auto e = std::get_if<AudioRate>(engine))
+				e->setParameters(noteOffset, width, retuneSpeed, attack, decay, sustain, release);
 		}
 		void setParametersDropout(float decay, float spin, float freqChance, float freqSmooth, float width) noexcept
 		{
-			dropout.setParameters(decay, spin, freqChance, freqSmooth, width);
+			if (auto e = std::get_if<Dropout>(engine))
+				e->setParameters(decay, spin, freqChance, freqSmooth, width);
 		}
 		void setParametersEnvFol(float atk, float rls, float gain, float width) noexcept
 		{
-			envFol.setParameters(atk, rls, gain, width);
+			if (auto e = std::get_if<EnvFol>(engine))
+				e->setParameters(atk, rls, gain, width);
+		}
+		void setParametersMacro(float m) noexcept
+		{
+			if (auto e = std::get_if<Macro>(engine))
+				e->setParameters(m);
+		}
+		void setParametersPitchbend(float rate) noexcept
+		{
+			if (auto e = std::get_if<Pitchbend>(engine))
+				e->setParameters(rate);
 		}
-		void setParametersMacro(float m) noexcept { macro.setParameters(m); }
-		void setParametersPitchbend(float rate) noexcept { pitchbend.setParameters(rate); }
 		void setParametersLFO(bool isSync, float rateFree, float rateSync, float waveform, float phase, float width) noexcept
 		{
-			lfo.setParameters(isSync, rateFree, rateSync, waveform, phase, width);
+			if (auto e = std::get_if<LFO>(engine))
+				e->setParameters(isSync, rateFree, rateSync, waveform, phase, width);
+		}
+		void setParametersCurve(bool isSync, float speed, float rateSync, float width) noexcept
+		{
+			if (auto e = std::get_if<Curve>(engine))
+				e->setParameters(isSync, speed, rateSync, width);
 		}
 
-		void processBlock(const float** samples, const juce::MidiBuffer& midi,
-			juce::AudioPlayHead* playHead, int numChannelsIn, int numChannelsOut, int numSamples) noexcept
+		// slow modulators are computed at a control rate that depends on their
+		// bandwidth and get interpolated to audio rate afterwards.
+		// numSamples is at the host's rate, high rate types write numSamples * getRateFactor()
+		template<typename Float>
+		void processBlock(const AudioInput<Float>& input, const MidiEvents& midi,
+			const Transport& transport, int numChannelsOut, int numSamples) noexcept
 		{
-			switch (type)
+			const auto numSamplesEngine = beginBlock(numSamples);
+			if (numSamplesEngine != 0)
+				processBlockEngine(getEngineBuffer(), input, midi, transport,
+					numChannelsOut, numSamplesEngine, blockDecimation);
+			endBlock(numChannelsOut, numSamples);
+		}
+
+		// processes several modulators' blocks at once. modulators of the same type that agree on
+		// length and decimation run their recursions side by side in lanes. that's the smoothers of
+		// macros and pitchbends, the envelopes and smoothers of dropouts and the free running lfos' phasors
+		template<typename Float>
+		static void processBlockLanes(Modulator* const* mods, int numMods, const AudioInput<Float>& input,
+			const MidiEvents& midi, const Transport& transport, int numChannelsOut, int numSamples) noexcept
+		{
+			std::array<int, modSys6::Smooth::MaxLanes> numSamplesEngine;
+			for (auto m = 0; m < numMods; ++m)
+				numSamplesEngine[m] = mods[m]->beginBlock(numSamples);
+
+			std::array<bool, modSys6::Smooth::MaxLanes> isDone;
+			isDone.fill(false);
+			for (auto m = 0; m < numMods; ++m)
 			{
-			case ModType::Perlin: return perlin(buffer, numChannelsOut, numSamples);
-			case ModType::AudioRate: return audioRate(buffer, midi, numChannelsOut, numSamples);
-			case ModType::Dropout: return dropout(buffer, numChannelsOut, numSamples);
-			case ModType::EnvFol: return envFol(buffer, samples, numChannelsIn, numChannelsOut, numSamples);
-			case ModType::Macro: return macro(buffer, numChannelsOut, numSamples);
-			case ModType::Pitchwheel: return pitchbend(buffer, numChannelsOut, numSamples, midi);
-			case ModType::LFO: return lfo(buffer, numChannelsOut, numSamples, playHead);
+				if (isDone[m])
+					continue;
+				std::array<Modulator*, modSys6::Smooth::MaxLanes> lanes;
+				auto numLanes = 0;
+				for (auto i = m; i < numMods; ++i)
+					if (!isDone[i] && mods[i]->type == mods[m]->type
+						&& numSamplesEngine[i] == numSamplesEngine[m]
+						&& mods[i]->blockDecimation == mods[m]->blockDecimation)
+					{
+						lanes[numLanes++] = mods[i];
+						isDone[i] = true;
+					}
+				if (numSamplesEngine[m] == 0)
+					continue;
+				if (numLanes > 1 && hasLanes(mods[m]->type))
+					processEngineLanes(lanes.data(), numLanes, midi, transport, numChannelsOut, numSamplesEngine[m]);
+				else
+					for (auto l = 0; l < numLanes; ++l)
+					{
+						auto& mod = *lanes[l];
+						mod.processBlockEngine(mod.getEngineBuffer(), input, midi, transport,
+							numChannelsOut, numSamplesEngine[m], mod.blockDecimation);
+					}
 			}
+
+			for (auto m = 0; m < numMods; ++m)
+				mods[m]->endBlock(numChannelsOut, numSamples);
 		}
 		
-		Tables& getTables() noexcept { return tables; }
-		const Tables& getTables() const noexcept { return tables; }
+		ModType getType() const noexcept { return type; }
+		// if the last block's buffer held the same value on every sample
+		bool isConstant() const noexcept { return constant; }
+
+		int getRateFactor() const noexcept { return isHighRate(type) ? highRateFactor : 1; }
+
+		LFOTablesBuilder& getTablesBuilder() noexcept { return tablesBuilder; }
+		EnvFolSettings& getEnvFolSettings() noexcept { return envFolSettings; }
+		CurveLoader& getCurveLoader() noexcept { return curveLoader; }
 
 		Buffer buffer;
 	protected:
 		const int numChannels;
 
-		Tables tables;
+		Buffer ctrlBuffer;
+		ControlRateUpsampler upsampler;
+		std::array<float, 2> lastValues;
+		float Fs;
+		int maxBlockSize, latency, highRateFactor;
+		ModType decimationType;
+		int blockDecimation;
+		bool constant;
+
+		LFOTablesBuilder tablesBuilder;
+		std::shared_ptr<Tables> tablesPtr;
+
+		EnvFolSettings envFolSettings;
+		CurveLoader curveLoader;
+		std::shared_ptr<curveFile::Curve> curvePtr;
+
+		const BeatsData& beatsData;
+		// prepare serves the requests on the message thread, while the worker might do so too
+		juce::CriticalSection requestMutex;
+		// guards the prepare arguments while the worker thread prepares new engines
+		juce::SpinLock prepareMutex;
+		std::atomic<int> requestedType;
+		std::atomic<uint64_t> perlinSeed, dropoutSeed;
+		std::atomic<int> seedVersion;
+		int seedVersionApplied;
+		// the bandwidth each type had when it last ran, so that a rebuilt engine starts at its decimation
+		std::array<std::atomic<float>, static_cast<int>(ModType::NumMods)> bandwidths;
+		// the newest built engine and the one that's live on the audio thread
+		RealtimePtr<PreparedEngine> engines;
+		std::shared_ptr<PreparedEngine> enginePtr;
+		Engine* engine;
+		ModType type;
+		bool engineIsFresh;
+		std::array<float, 2> fadeFrom;
+		int fadeIdx, fadeLength;
 
-		Perlin perlin;
-		AudioRate audioRate;
-		Dropout dropout;
-		EnvFol envFol;
-		Macro macro;
-		Pitchbend pitchbend;
-		LFO lfo;
+		// returns how many samples the engine has to render this block
+		int beginBlock(int numSamples) noexcept
+		{
+			blockDecimation = 1;
+			if (numSamples == 0)
+				return 0;
 
-		ModType type;
+			if (type == ModType::LFO)
+			{
+				tablesPtr = tablesBuilder.updateAndLoad();
+				std::get<LFO>(*engine).setTables(tablesPtr.get());
+			}
+			else if (type == ModType::Curve)
+			{
+				curvePtr = curveLoader.updateAndLoad();
+				std::get<Curve>(*engine).setCurve(curvePtr.get());
+			}
+			// new engines start from settled parameters
+			if (engineIsFresh)
+			{
+				resetEngine();
+				engineIsFresh = false;
+			}
+
+			if (!isControlRate(type))
+				return numSamples * getRateFactor();
+
+			updateDecimation();
+			blockDecimation = upsampler.getDecimation();
+			return blockDecimation == 1 ? numSamples : upsampler.getNumControlSamples(numSamples);
+		}
+
+		Buffer& getEngineBuffer() noexcept { return blockDecimation == 1 ? buffer : ctrlBuffer; }
+
+		void endBlock(int numChannelsOut, int numSamples) noexcept
+		{
+			if (numSamples == 0)
+				return;
+
+			if (blockDecimation != 1)
+			{
+				float* dest[] = { buffer[0].data(), buffer[1].data() };
+				const float* ctrl[] = { ctrlBuffer[0].data(), ctrlBuffer[1].data() };
+				upsampler(dest, ctrl, numChannelsOut, numSamples);
+			}
+
+			const auto numSamplesOut = numSamples * getRateFactor();
+			if (fadeIdx < fadeLength)
+				processFade(numChannelsOut, numSamplesOut);
+			constant = true;
+			for (auto ch = 0; ch < numChannelsOut; ++ch)
+			{
+				const auto buf = buffer[ch].data();
+				lastValues[ch] = buf[numSamplesOut - 1];
+				constant = constant && isConstant(buf, numSamplesOut);
+			}
+		}
+
+		// fades from the old engine's last output into the new engine's
+		void processFade(int numChannelsOut, int numSamples) noexcept
+		{
+			const auto fadeLengthInv = 1.f / static_cast<float>(fadeLength);
+			const auto numFade = std::min(numSamples, fadeLength - fadeIdx);
+			for (auto ch = 0; ch < numChannelsOut; ++ch)
+			{
+				auto buf = buffer[ch].data();
+				const auto from = fadeFrom[ch];
+				for (auto s = 0; s < numFade; ++s)
+				{
+					const auto x = static_cast<float>(fadeIdx + s + 1) * fadeLengthInv;
+					buf[s] = from + x * (buf[s] - from);
+				}
+			}
+			fadeIdx += numFade;
+		}
+
+		// exits on the first sample that differs, so moving signals barely pay for it
+		static bool isConstant(const float* buf, int numSamples) noexcept
+		{
+			const auto val = buf[0];
+			for (auto s = 1; s < numSamples; ++s)
+				if (buf[s] != val)
+					return false;
+			return true;
+		}
+
+		// compensates for potential spline interpolation
+		static int getBufferSize(int _maxBlockSize, int _highRateFactor) noexcept
+		{
+			return _maxBlockSize * _highRateFactor + 4;
+		}
+
+		static bool isControlRate(ModType t) noexcept
+		{
+			return t != ModType::AudioRate && t != ModType::EnvFol;
+		}
+		static bool isHighRate(ModType t) noexcept
+		{
+			return t == ModType::AudioRate;
+		}
+
+		float getBandwidth(const Engine& e) const noexcept
+		{
+			switch (typeOf(e))
+			{
+			case ModType::Perlin: return std::get<Perlin>(e).getBandwidth();
+			case ModType::Dropout: return std::get<Dropout>(e).getBandwidth();
+			case ModType::Macro: return std::get<Macro>(e).getBandwidth();
+			case ModType::Pitchwheel: return std::get<Pitchbend>(e).getBandwidth();
+			case ModType::LFO: return std::get<LFO>(e).getBandwidth();
+			case ModType::Curve: return std::get<Curve>(e).getBandwidth();
+			default: return Fs;
+			}
+		}
+
+		// coarsens only with plenty of headroom, so that K doesn't flicker between 2 values
+		int findDecimation(float bandwidth, int decimation) const noexcept
+		{
+			while (decimation < MaxDecimation && Fs >= 4.f * bandwidth * static_cast<float>(decimation))
+				decimation *= 2;
+			while (decimation > 1 && Fs < bandwidth * static_cast<float>(decimation))
+				decimation /= 2;
+			return decimation;
+		}
+
+		// worker thread. a new engine hasn't got its parameters yet,
+		// so the bandwidth its type last ran at is the better guess
+		int getTargetDecimation(const Engine& e) const noexcept
+		{
+			const auto t = typeOf(e);
+			if (!isControlRate(t))
+				return 1;
+			auto bandwidth = bandwidths[static_cast<int>(t)].load();
+			if (bandwidth < 0.f)
+				bandwidth = getBandwidth(e) * ControlRateHeadroom;
+			return findDecimation(bandwidth, 1);
+		}
+
+		void updateDecimation() noexcept
+		{
+			const auto bandwidth = getBandwidth(*engine) * ControlRateHeadroom;
+			bandwidths[static_cast<int>(type)].store(bandwidth);
+			const auto decimation = findDecimation(bandwidth, upsampler.getDecimation());
+
+			if (decimation == upsampler.getDecimation() && type == decimationType)
+				return;
+			decimationType = type;
+			prepareEngine(*engine, decimation);
+			upsampler.reset(decimation, lastValues.data(), numChannels);
+		}
+
+		static ModType typeOf(const Engine& e) noexcept { return static_cast<ModType>(e.index()); }
+
+		// building and preparing happen here, so that the audio thread only swaps pointers.
+		// the engine gets prepared at the decimation it's going to run at
+		void buildRequestedEngine()
+		{
+			const auto t = requestedType.exchange(-1);
+			if (t == -1 || static_cast<int>(engines.loadUpdatedPtr()->engine.index()) == t)
+				return;
+			// an lfo's tables are there before the lfo goes live
+			if (t == static_cast<int>(ModType::LFO))
+				tablesBuilder.process(true);
+			auto e = makeEngine(static_cast<ModType>(t));
+			applySeed(e->engine);
+			const juce::SpinLock::ScopedLockType lock(prepareMutex);
+			if (maxBlockSize != 0)
+			{
+				e->decimation = getTargetDecimation(e->engine);
+				prepareEngine(e->engine, e->decimation);
+			}
+			engines.replaceUpdatedPtrWith(e);
+		}
+
+		std::shared_ptr<PreparedEngine> makeEngine(ModType t) const
+		{
+			switch (t)
+			{
+			case ModType::AudioRate: return std::make_shared<PreparedEngine>(std::in_place_type<AudioRate>, numChannels);
+			case ModType::Dropout: return std::make_shared<PreparedEngine>(std::in_place_type<Dropout>, numChannels);
+			case ModType::EnvFol: return std::make_shared<PreparedEngine>(std::in_place_type<EnvFol>, numChannels, envFolSettings);
+			case ModType::Macro: return std::make_shared<PreparedEngine>(std::in_place_type<Macro>, numChannels);
+			case ModType::Pitchwheel: return std::make_shared<PreparedEngine>(std::in_place_type<Pitchbend>, numChannels);
+			case ModType::LFO: return std::make_shared<PreparedEngine>(std::in_place_type<LFO>, numChannels, beatsData);
+			case ModType::Curve: return std::make_shared<PreparedEngine>(std::in_place_type<Curve>, numChannels, beatsData);
+			default: return std::make_shared<PreparedEngine>(std::in_place_type<Perlin>, numChannels, 8);
+			}
+		}
+
+		void applySeed(Engine& e) noexcept
+		{
+			if (auto p = std::get_if<Perlin>(&e))
+				p->setSeed(perlinSeed.load());
+			else if (auto d = std::get_if<Dropout>(&e))
+				d->setSeed(dropoutSeed.load());
+		}
+
+		void resetEngine() noexcept
+		{
+			std::visit([](auto& e) { e.reset(); }, *engine);
+		}
+
+		// control rate types run at Fs / decimation, the others at their own rate
+		void prepareEngine(Engine& e, int decimation)
+		{
+			const auto fsCtrl = Fs / static_cast<float>(decimation);
+			// the upsampler's lag is compensated by running synced lfos ahead of it
+			const auto latencyCtrl = decimation == 1 ? latency : latency / decimation - 2;
+			switch (typeOf(e))
+			{
+			case ModType::Perlin: return std::get<Perlin>(e).prepare(fsCtrl, maxBlockSize);
+			case ModType::AudioRate: return std::get<AudioRate>(e).prepare(Fs * static_cast<float>(highRateFactor));
+			case ModType::Dropout: return std::get<Dropout>(e).prepare(fsCtrl);
+			case ModType::EnvFol: return std::get<EnvFol>(e).prepare(Fs, latency);
+			case ModType::Macro: return std::get<Macro>(e).prepare(fsCtrl);
+			case ModType::Pitchwheel: return std::get<Pitchbend>(e).prepare(fsCtrl);
+			case ModType::LFO: return std::get<LFO>(e).prepare(fsCtrl, latencyCtrl);
+			case ModType::Curve: return std::get<Curve>(e).prepare(fsCtrl, latencyCtrl);
+			}
+		}
+
+		static bool hasLanes(ModType t) noexcept
+		{
+			return t == ModType::Macro || t == ModType::Pitchwheel || t == ModType::Dropout || t == ModType::LFO;
+		}
+
+		// all modulators share type, length and decimation
+		static void processEngineLanes(Modulator* const* mods, int numMods, const MidiEvents& midi,
+			const Transport& transport, int numChannelsOut, int numSamples) noexcept
+		{
+			std::array<Buffer*, modSys6::Smooth::MaxLanes> bufs;
+			for (auto m = 0; m < numMods; ++m)
+				bufs[m] = &mods[m]->getEngineBuffer();
+
+			switch (mods[0]->type)
+			{
+			case ModType::Macro:
+			{
+				std::array<Macro*, modSys6::Smooth::MaxLanes> macros;
+				for (auto m = 0; m < numMods; ++m)
+					macros[m] = &std::get<Macro>(*mods[m]->engine);
+				return Macro::processLanes(macros.data(), bufs.data(), numMods, numChannelsOut, numSamples);
+			}
+			case ModType::Pitchwheel:
+			{
+				std::array<Pitchbend*, modSys6::Smooth::MaxLanes> bends;
+				for (auto m = 0; m < numMods; ++m)
+					bends[m] = &std::get<Pitchbend>(*mods[m]->engine);
+				return Pitchbend::processLanes(bends.data(), bufs.data(), numMods, numChannelsOut,
+					numSamples, midi, mods[0]->blockDecimation);
+			}
+			case ModType::Dropout:
+			{
+				std::array<Dropout*, modSys6::Smooth::MaxLanes> drops;
+				for (auto m = 0; m < numMods; ++m)
+					drops[m] = &std::get<Dropout>(*mods[m]->engine);
+				for (auto m = 0; m < numMods; m += Dropout::MaxLanes)
+					Dropout::processLanes(drops.data() + m, bufs.data() + m, std::min(numMods - m, Dropout::MaxLanes),
+						numChannelsOut, numSamples);
+				return;
+			}
+			case ModType::LFO:
+			{
+				std::array<LFO*, modSys6::Smooth::MaxLanes> lfos;
+				for (auto m = 0; m < numMods; ++m)
+					lfos[m] = &std::get<LFO>(*mods[m]->engine);
+				return LFO::processLanes(lfos.data(), bufs.data(), numMods, numChannelsOut, numSamples, transport);
+			}
+			default: return;
+			}
+		}
+
+		template<typename Float>
+		void processBlockEngine(Buffer& buf, const AudioInput<Float>& input, const MidiEvents& midi,
+			const Transport& transport, int numChannelsOut, int numSamples, int decimation) noexcept
+		{
+			switch (type)
+			{
+			case ModType::Perlin: return std::get<Perlin>(*engine)(buf, numChannelsOut, numSamples);
+			case ModType::AudioRate: return std::get<AudioRate>(*engine)(buf, midi, numChannelsOut, numSamples, highRateFactor);
+			case ModType::Dropout: return std::get<Dropout>(*engine)(buf, numChannelsOut, numSamples);
+			case ModType::EnvFol: return std::get<EnvFol>(*engine)(buf, input, numChannelsOut, numSamples);
+			case ModType::Macro: return std::get<Macro>(*engine)(buf, numChannelsOut, numSamples);
+			case ModType::Pitchwheel: return std::get<Pitchbend>(*engine)(buf, numChannelsOut, numSamples, midi, decimation);
+			case ModType::LFO: return std::get<LFO>(*engine)(buf, numChannelsOut, numSamples, transport);
+			case ModType::Curve: return std::get<Curve>(*engine)(buf, numChannelsOut, numSamples, transport);
+			}
+		}
+	};
+
+	/*
+	* owns the modulator slots and their buffers, which share one pooled allocation.
+	* slots of the same type are handed to Modulator::processBlockLanes together,
+	* so that their state is walked side by side instead of slot after slot.
+	* inactive slots are skipped entirely.
+	* each slot only holds the engine of its type. switching types builds the new
+	* engine on the bank's thread, the slot swaps it in with updateEngine.
+	* the same thread also builds the lfos' tables and loads the curves of all slots.
+	*/
+	class ModulatorBank :
+		public juce::Thread
+	{
+	public:
+		ModulatorBank(int numSlots, int numChannels, const modSys6::BeatsData& beatsData) :
+			juce::Thread("NEL Engine Builder"),
+			mods(),
+			active(numSlots, true),
+			pool()
+		{
+			mods.reserve(numSlots);
+			for (auto m = 0; m < numSlots; ++m)
+				mods.emplace_back(std::make_unique<Modulator>(numChannels, beatsData, *this));
+			startThread();
+		}
+		~ModulatorBank()
+		{
+			stopThread(1000);
+		}
+
+		// any thread but the audio thread
+		void requestType(int m, ModType t)
+		{
+			mods[m]->requestType(t);
+			notify();
+		}
+
+		void run() override
+		{
+			while (!threadShouldExit())
+			{
+				wait(-1);
+				processRequests();
+			}
+		}
+		// serves all slots' requests on the calling thread, which must not be the audio thread
+		void processRequests()
+		{
+			for (auto& mod : mods)
+				mod->processRequests();
+		}
+
+		void prepare(float sampleRate, int maxBlockSize, int latency, int highRateFactor)
+		{
+			const auto slotSize = Modulator::getMemorySize(maxBlockSize, highRateFactor);
+			pool.assign(static_cast<size_t>(slotSize) * mods.size(), 0.f);
+			for (auto m = 0; m < size(); ++m)
+				mods[m]->prepare(sampleRate, maxBlockSize, latency, highRateFactor, pool.data() + m * slotSize);
+		}
+
+		Modulator& operator[](int m) noexcept { return *mods[m]; }
+		const Modulator& operator[](int m) const noexcept { return *mods[m]; }
+		int size() const noexcept { return static_cast<int>(mods.size()); }
+
+		// inactive slots don't process and keep their last buffer
+		void setActive(int m, bool a) noexcept { active[m] = a; }
+		bool isActive(int m) const noexcept { return active[m] != 0; }
+
+		template<typename Float>
+		void processBlock(const AudioInput<Float>& input, const MidiEvents& midi,
+			const Transport& transport, int numChannelsOut, int numSamples) noexcept
+		{
+			std::array<Modulator*, modSys6::Smooth::MaxLanes> group;
+			const auto numSlots = size();
+			for (auto m = 0; m < numSlots; ++m)
+			{
+				if (!isActive(m))
+					continue;
+				const auto type = mods[m]->getType();
+				{ // SKIP IF ALREADY GROUPED WITH AN EARLIER SLOT
+					auto isGrouped = false;
+					for (auto i = 0; i < m; ++i)
+						isGrouped = isGrouped || (isActive(i) && mods[i]->getType() == type);
+					if (isGrouped)
+						continue;
+				}
+				auto numGroup = 0;
+				for (auto i = m; i < numSlots; ++i)
+					if (isActive(i) && mods[i]->getType() == type)
+					{
+						group[numGroup++] = mods[i].get();
+						if (numGroup == modSys6::Smooth::MaxLanes)
+						{
+							Modulator::processBlockLanes(group.data(), numGroup, input, midi, transport,
+								numChannelsOut, numSamples);
+							numGroup = 0;
+						}
+					}
+				if (numGroup != 0)
+					Modulator::processBlockLanes(group.data(), numGroup, input, midi, transport,
+						numChannelsOut, numSamples);
+			}
+		}
+
+	protected:
+		std::vector<std::unique_ptr<Modulator>> mods;
+		std::vector<uint8_t> active;
+		std::vector<float> pool;
 	};
 }
 
@@ -1648,9 +3581,6 @@ make trigger mod
 	duration
 	check parameter smoothing
 
-envFol
-	lookahead?
-
 make konami mod
 
 */
@@ -1,6 +1,8 @@
 #pragma once
 #include <JuceHeader.h>
+#include "../Interpolation.h"
 #include <limits>
+#include <type_traits>
 
 namespace vibrato
 {
@@ -39,33 +41,45 @@ namespace vibrato
 	
 	using Buffer = std::array<std::vector<float>, 2>;
 
+	template<typename Float>
 	struct Delay
 	{
 		Delay(Buffer& vibBuf, int channel, InterpolationType it) :
 			delayBuffer(vibBuf),
 			ringBuffer(),
-			delaySize(0.f), delayMid(0.f), delayMax(0.f),
-			interpolationType(it),
-			ch(channel)
+			readIdx(), readFrac(),
+			taps(),
+			delaySize(0.), delayMid(0.), delayMax(0.),
+			tapsFrac(static_cast<Float>(-1)),
+			interpolationType(it), tapsType(it),
+			ch(channel), tapsStart(0), numTaps(0)
 		{
 		}
+		void prepare(int blockSize)
+		{
+			readIdx.resize(blockSize, 0);
+			readFrac.resize(blockSize, static_cast<Float>(0));
+		}
 		void setDelaySize(size_t s)
 		{
-			ringBuffer.resize(s, 0.f);
-			delaySize = static_cast<float>(s);
-			delayMid = s * .5f;
-			delayMax = delaySize - 1.f;
+			ringBuffer.resize(s, static_cast<Float>(0));
+			delaySize = static_cast<double>(s);
+			delayMid = delaySize * .5;
+			delayMax = delaySize - 1.;
 		}
 		void setInterpolationType(InterpolationType t) noexcept { interpolationType = t; }
 		// PROCESS
 		void processBlockBypassed() noexcept
 		{
 			for (auto& s : ringBuffer)
-				s = 0.f;
+				s = static_cast<Float>(0);
 		}
-		void processBlock(float* samples,
-			int numSamples, const size_t* writeHead) noexcept
+		// isStatic: the delay buffer holds the same value on every sample of the block
+		void processBlock(Float* samples,
+			int numSamples, const size_t* writeHead, bool isStatic) noexcept
 		{
+			if (isStatic)
+				return processBlockStatic(samples, numSamples, writeHead);
 			processBlockReadHead(numSamples, writeHead);
 			processBlockDelay(samples, numSamples, writeHead);
 		}
@@ -73,29 +87,122 @@ namespace vibrato
 		size_t size() const noexcept { return ringBuffer.size(); }
 		InterpolationType getInterpolationType() const noexcept { return interpolationType; }
 	private:
+		// big enough for the sinc's 19 taps around the center
+		static constexpr int ImpulseSize = 32;
+		static constexpr int ImpulseCenter = 12;
+
 		Buffer& delayBuffer;
-		std::vector<float> ringBuffer;
-		float delaySize, delayMid, delayMax;
-		InterpolationType interpolationType;
-		int ch;
+		std::vector<Float> ringBuffer;
+		std::vector<int> readIdx;
+		std::vector<Float> readFrac;
+		std::array<Float, ImpulseSize> taps;
+		double delaySize, delayMid, delayMax;
+		Float tapsFrac;
+		InterpolationType interpolationType, tapsType;
+		int ch, tapsStart, numTaps;
+
+		Float interpolate(const Float* buffer, int iFloor, Float frac, int sizeInt) const noexcept
+		{
+			switch (interpolationType)
+			{
+			case InterpolationType::Lerp: return interpolation::lerp(buffer, iFloor, frac, sizeInt);
+			case InterpolationType::Spline: return interpolation::cubicHermiteSpline(buffer, iFloor, frac, sizeInt);
+			case InterpolationType::LagRange: return interpolation::lagrange(buffer, iFloor, frac, sizeInt, 9);
+			case InterpolationType::Sinc: return interpolation::lanczosSinc(buffer, iFloor, frac, sizeInt, 9);
+			default: return buffer[iFloor];
+			}
+		}
+
+		// the taps are the interpolator's response to impulses,
+		// so that the static delay sounds exactly like the moving one
+		void updateTaps(Float frac) noexcept
+		{
+			if (frac == tapsFrac && interpolationType == tapsType)
+				return;
+			tapsFrac = frac;
+			tapsType = interpolationType;
+
+			std::array<Float, ImpulseSize> impulse;
+			impulse.fill(static_cast<Float>(0));
+			auto first = ImpulseSize, last = -1;
+			for (auto i = 0; i < ImpulseSize; ++i)
+			{
+				impulse[i] = static_cast<Float>(1);
+				taps[i] = interpolate(impulse.data(), ImpulseCenter, frac, ImpulseSize);
+				impulse[i] = static_cast<Float>(0);
+				if (std::abs(taps[i]) < static_cast<Float>(1e-7))
+					taps[i] = static_cast<Float>(0);
+				else
+				{
+					first = std::min(first, i);
+					last = i;
+				}
+			}
+			if (last == -1)
+			{
+				tapsStart = 0;
+				numTaps = 0;
+				return;
+			}
+			numTaps = last - first + 1;
+			tapsStart = first - ImpulseCenter;
+			for (auto i = 0; i < numTaps; ++i)
+				taps[i] = taps[first + i];
+		}
+
+		// a delay that doesn't move is a fixed FIR over the ring buffer, or a plain copy if it's an integer
+		void processBlockStatic(Float* samples, int numSamples, const size_t* writeHead) noexcept
+		{
+			const auto dly = juce::jlimit(0., delayMax, static_cast<double>(delayBuffer[ch][0]) * delayMid + delayMid);
+			const auto dlyFloor = std::floor(dly);
+			updateTaps(static_cast<Float>(1. - (dly - dlyFloor)));
+
+			const auto sizeInt = static_cast<int>(size());
+			const auto offset = static_cast<int>(dlyFloor) + 1 - tapsStart;
+			const auto isCopy = numTaps == 1 && taps[0] == static_cast<Float>(1);
+			for (auto s = 0; s < numSamples; ++s)
+			{
+				ringBuffer[writeHead[s]] = samples[s];
+				auto idx = static_cast<int>(writeHead[s]) - offset;
+				while (idx < 0)
+					idx += sizeInt;
+				if (isCopy)
+					samples[s] = ringBuffer[idx];
+				else
+				{
+					auto sum = static_cast<Float>(0);
+					for (auto i = 0; i < numTaps; ++i)
+					{
+						auto j = idx + i;
+						if (j >= sizeInt)
+							j -= sizeInt;
+						sum += taps[i] * ringBuffer[j];
+					}
+					samples[s] = sum;
+				}
+			}
+		}
 
+		// read head as integer index + fraction, so that the fraction
+		// doesn't lose precision with big ring buffers
 		void processBlockReadHead(int numSamples, const size_t* writeHead) noexcept
 		{
-			auto& buf = delayBuffer[ch];
-			// map buffer [-1, 1] to [0, delaySize]
-			juce::FloatVectorOperations::multiply(buf.data(), delayMid, numSamples);
-			juce::FloatVectorOperations::add(buf.data(), delayMid, numSamples);
+			const auto buf = delayBuffer[ch].data();
+			const auto sizeInt = static_cast<int>(size());
 			for (auto s = 0; s < numSamples; ++s)
 			{
-				const auto dly = buf[s];
-				auto rh = static_cast<float>(writeHead[s]) - dly;
-				if (rh < 0.f)
-					rh += delaySize;
-				buf[s] = juce::jlimit(0.f, delayMax, rh);
+				// map buffer [-1, 1] to [0, delayMax]
+				const auto dly = juce::jlimit(0., delayMax, static_cast<double>(buf[s]) * delayMid + delayMid);
+				const auto dlyFloor = std::floor(dly);
+				auto rIdx = static_cast<int>(writeHead[s]) - static_cast<int>(dlyFloor) - 1;
+				if (rIdx < 0)
+					rIdx += sizeInt;
+				readIdx[s] = rIdx;
+				readFrac[s] = static_cast<Float>(1. - (dly - dlyFloor));
 			}
 		}
 		
-		void processBlockDelay(float* samples,
+		void processBlockDelay(Float* samples,
 			int numSamples, const size_t* writeHead) noexcept
 		{
 			switch (interpolationType)
@@ -106,47 +213,47 @@ namespace vibrato
 			case InterpolationType::Sinc: return processBlockDelaySINC(samples, numSamples, writeHead);
 			}
 		}
-		void processBlockDelayLERP(float* samples,
+		void processBlockDelayLERP(Float* samples,
 			const int numSamples, const size_t* writeHead) noexcept
 		{
 			const auto sizeInt = static_cast<int>(size());
 			for (auto s = 0; s < numSamples; ++s)
 			{
 				ringBuffer[writeHead[s]] = samples[s];
-				const auto val = interpolation::lerp(ringBuffer.data(), delayBuffer[ch][s], sizeInt);
+				const auto val = interpolation::lerp(ringBuffer.data(), readIdx[s], readFrac[s], sizeInt);
 				samples[s] = val;
 			}
 		}
-		void processBlockDelaySPLINE(float* samples,
+		void processBlockDelaySPLINE(Float* samples,
 			const int numSamples, const size_t* writeHead) noexcept
 		{
 			const auto sizeInt = static_cast<int>(size());
 			for (auto s = 0; s < numSamples; ++s)
 			{
 				ringBuffer[writeHead[s]] = samples[s];
-				const auto val = interpolation::cubicHermiteSpline(ringBuffer.data(), delayBuffer[ch][s], sizeInt);
+				const auto val = interpolation::cubicHermiteSpline(ringBuffer.data(), readIdx[s], readFrac[s], sizeInt);
 				samples[s] = val;
 			}
 		}
-		void processBlockDelayLAGRANGE(float* samples,
+		void processBlockDelayLAGRANGE(Float* samples,
 			const int numSamples, const size_t* writeHead) noexcept
 		{
 			const auto sizeInt = static_cast<int>(size());
 			for (auto s = 0; s < numSamples; ++s)
 			{
 				ringBuffer[writeHead[s]] = samples[s];
-				const auto val = interpolation::lagrange(ringBuffer.data(), delayBuffer[ch][s], sizeInt, 9);
+				const auto val = interpolation::lagrange(ringBuffer.data(), readIdx[s], readFrac[s], sizeInt, 9);
 				samples[s] = val;
 			}
 		}
-		void processBlockDelaySINC(float* samples,
+		void processBlockDelaySINC(Float* samples,
 			const int numSamples, const size_t* writeHead) noexcept
 		{
 			const auto sizeInt = static_cast<int>(size());
 			for (auto s = 0; s < numSamples; ++s)
 			{
 				ringBuffer[writeHead[s]] = samples[s];
-				const auto val = interpolation::lanczosSinc(ringBuffer.data(), delayBuffer[ch][s], sizeInt, 9);
+				const auto val = interpolation::lanczosSinc(ringBuffer.data(), readIdx[s], readFrac[s], sizeInt, 9);
 				samples[s] = val;
 			}
 		}
@@ -154,12 +261,20 @@ namespace vibrato
 
 	struct Processor
 	{
+		template<typename Float>
+		using Delays = std::array<Delay<Float>, 2>;
+
 		Processor(Buffer& vibBuf, int _numChannels) :
 			writeHead(),
-			delay
+			delayF
 			{
-				Delay(vibBuf, 0, InterpolationType::Spline),
-				Delay(vibBuf, 1, InterpolationType::Spline)
+				Delay<float>(vibBuf, 0, InterpolationType::Spline),
+				Delay<float>(vibBuf, 1, InterpolationType::Spline)
+			},
+			delayD
+			{
+				Delay<double>(vibBuf, 0, InterpolationType::Spline),
+				Delay<double>(vibBuf, 1, InterpolationType::Spline)
 			},
 			wHead(static_cast<size_t>(-1)),
 			rBufferSize(0),
@@ -172,12 +287,21 @@ namespace vibrato
 		void prepareToPlay(const int blockSize)
 		{
 			writeHead.resize(blockSize, 0);
+			for (auto ch = 0; ch < numChannels; ++ch)
+			{
+				delayF[ch].prepare(blockSize);
+				delayD[ch].prepare(blockSize);
+			}
 		}
-		void resizeDelay(size_t size)
+		// only the delays of the used sample type get memory
+		void resizeDelay(size_t size, bool doublePrecision)
 		{
 			rBufferSize = size;
 			for (auto ch = 0; ch < numChannels; ++ch)
-				delay[ch].setDelaySize(rBufferSize);
+			{
+				delayF[ch].setDelaySize(doublePrecision ? 0 : rBufferSize);
+				delayD[ch].setDelaySize(doublePrecision ? rBufferSize : 0);
+			}
 		}
 		void triggerUpdate() noexcept
 		{
@@ -186,11 +310,15 @@ namespace vibrato
 		void setInterpolationType(InterpolationType t) noexcept
 		{
 			interpolationType.store(t);
-			for (auto& d : delay)
+			for (auto& d : delayF)
+				d.setInterpolationType(t);
+			for (auto& d : delayD)
 				d.setInterpolationType(t);
 		}
 		// PROCESS
-		bool processBlock(juce::AudioBuffer<float>& audioBuffer, juce::AudioProcessor* p, int numChannelsOut)
+		// isStatic: the vibrato buffer is constant over the whole block
+		template<typename Float>
+		bool processBlock(juce::AudioBuffer<Float>& audioBuffer, juce::AudioProcessor* p, int numChannelsOut, bool isStatic)
 		{
 			if (wannaUpdate.load())
 			{
@@ -198,7 +326,7 @@ namespace vibrato
 				wannaUpdate.store(false);
 				return false;
 			}
-			processBlock(audioBuffer, numChannelsOut);
+			processBlock(audioBuffer, numChannelsOut, isStatic);
 			return true;
 		}
 		bool processBlockBypassed(juce::AudioProcessor* p, int numChannelsOut)
@@ -210,7 +338,10 @@ namespace vibrato
 				return false;
 			}
 			for (auto ch = 0; ch < numChannelsOut; ++ch)
-				delay[ch].processBlockBypassed();
+			{
+				delayF[ch].processBlockBypassed();
+				delayD[ch].processBlockBypassed();
+			}
 			return true;
 		}
 		// GET
@@ -228,19 +359,31 @@ namespace vibrato
 		}
 	protected:
 		std::vector<size_t> writeHead;
-		std::array<Delay, 2> delay;
+		Delays<float> delayF;
+		Delays<double> delayD;
 		size_t wHead, rBufferSize;
 		const int numChannels;
 		std::atomic<bool> wannaUpdate;
 		std::atomic<InterpolationType> interpolationType;
 
-		void processBlock(juce::AudioBuffer<float>& audioBuffer, int numChannelsOut) noexcept
+		template<typename Float>
+		Delays<Float>& getDelays() noexcept
+		{
+			if constexpr (std::is_same<Float, double>::value)
+				return delayD;
+			else
+				return delayF;
+		}
+
+		template<typename Float>
+		void processBlock(juce::AudioBuffer<Float>& audioBuffer, int numChannelsOut, bool isStatic) noexcept
 		{
 			auto samples = audioBuffer.getArrayOfWritePointers();
 			const auto numSamples = audioBuffer.getNumSamples();
 			processBlockWriteHead(numSamples);
+			auto& delay = getDelays<Float>();
 			for (auto ch = 0; ch < numChannelsOut; ++ch)
-				delay[ch].processBlock(samples[ch], numSamples, writeHead.data());
+				delay[ch].processBlock(samples[ch], numSamples, writeHead.data(), isStatic);
 		}
 
 		void processBlockWriteHead(const int numSamples) noexcept
@@ -254,7 +397,7 @@ namespace vibrato
 			}
 		}
 		
-		const size_t ringBufferSize() const noexcept { return delay[0].size(); }
+		const size_t ringBufferSize() const noexcept { return rBufferSize; }
 	};
 }
 
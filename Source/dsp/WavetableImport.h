@@ -0,0 +1,220 @@
+#pragma once
+#include <JuceHeader.h>
+#include <vector>
+#include <cstring>
+
+// imports user wavetables from wav or raw 32 bit float files.
+// files are read through memory mapping and every frame gets resampled band-limited
+// to the table size. files whose length isn't a multiple of the frame size are one cycle. the result is cached as a binary next to the source file,
+// so that loading it again only needs to map the cache.
+namespace wtImport
+{
+	// frame size of the source if the file's length is a multiple of it (serum's convention)
+	static constexpr int DefaultFrameSize = 2048;
+	static constexpr char CacheMagic[4] = { 'N', 'W', 'T', '1' };
+
+	struct CacheHeader
+	{
+		char magic[4];
+		uint32_t numFrames, frameSize;
+		uint64_t sourceSize;
+		int64_t sourceModTime;
+		uint64_t hash;
+	};
+
+	// fnv-1a, identifies a source file in patches
+	inline uint64_t makeHash(const void* data, size_t size) noexcept
+	{
+		const auto bytes = static_cast<const uint8_t*>(data);
+		uint64_t hash = 14695981039346656037ull;
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	inline juce::File getCacheFile(const juce::File& source)
+	{
+		return source.getSiblingFile(source.getFileName() + ".nelwt");
+	}
+
+	inline bool isRawFloat(const juce::File& file)
+	{
+		return file.hasFileExtension("raw;f32");
+	}
+
+	// reads channel 0 of the source into samples, hashes the file's bytes
+	inline bool readSource(const juce::File& file, std::vector<float>& samples, uint64_t& hash)
+	{
+		juce::MemoryMappedFile mapped(file, juce::MemoryMappedFile::readOnly);
+		if (mapped.getData() == nullptr || mapped.getSize() == 0)
+			return false;
+		hash = makeHash(mapped.getData(), mapped.getSize());
+
+		if (isRawFloat(file))
+		{
+			const auto numSamples = mapped.getSize() / sizeof(float);
+			samples.resize(numSamples);
+			std::memcpy(samples.data(), mapped.getData(), numSamples * sizeof(float));
+			return numSamples != 0;
+		}
+
+		juce::AudioFormatManager manager;
+		manager.registerBasicFormats();
+		auto format = manager.findFormatForFileExtension(file.getFileExtension());
+		if (format == nullptr)
+			return false;
+		std::unique_ptr<juce::MemoryMappedAudioFormatReader> reader(format->createMemoryMappedReader(file));
+		if (reader == nullptr || !reader->mapEntireFile())
+			return false;
+		const auto numSamples = static_cast<int>(reader->lengthInSamples);
+		if (numSamples == 0)
+			return false;
+		juce::AudioBuffer<float> buffer(1, numSamples);
+		reader->read(&buffer, 0, numSamples, 0, true, false);
+		samples.assign(buffer.getReadPointer(0), buffer.getReadPointer(0) + numSamples);
+		return true;
+	}
+
+	// periodic band-limited resampling of one cycle: the cycle gets interpolated to the next
+	// power of 2 for an fft, harmonics above both nyquists are dropped, inverse fft at the destination size
+	inline void resampleFrame(const float* src, int srcSize, float* dest, int destSize, juce::dsp::FFT& fftDest)
+	{
+		const auto order = static_cast<int>(std::ceil(std::log2(static_cast<double>(srcSize))));
+		const auto size = 1 << order;
+		std::vector<float> bins;
+		bins.resize(size * 2, 0.f);
+		if (size == srcSize)
+			std::copy(src, src + srcSize, bins.begin());
+		else
+		{ // CUBIC HERMITE, WRAPPING AROUND THE CYCLE
+			const auto wrap = [srcSize](int i) { return i < 0 ? i + srcSize : i >= srcSize ? i - srcSize : i; };
+			const auto ratio = static_cast<double>(srcSize) / static_cast<double>(size);
+			for (auto n = 0; n < size; ++n)
+			{
+				const auto x = static_cast<double>(n) * ratio;
+				const auto i = static_cast<int>(x);
+				const auto t = static_cast<float>(x - static_cast<double>(i));
+				const auto v0 = src[wrap(i - 1)];
+				const auto v1 = src[i];
+				const auto v2 = src[wrap(i + 1)];
+				const auto v3 = src[wrap(i + 2)];
+				const auto c1 = .5f * (v2 - v0);
+				const auto c2 = v0 - 2.5f * v1 + 2.f * v2 - .5f * v3;
+				const auto c3 = 1.5f * (v1 - v2) + .5f * (v3 - v0);
+				bins[n] = ((c3 * t + c2) * t + c1) * t + v1;
+			}
+		}
+		juce::dsp::FFT fft(order);
+		fft.performRealOnlyForwardTransform(bins.data());
+
+		std::vector<float> binsDest;
+		binsDest.resize(destSize * 2, 0.f);
+		const auto numHarmonics = std::min(srcSize, destSize) / 2;
+		const auto gain = static_cast<float>(destSize) / static_cast<float>(size);
+		for (auto k = 0; k < numHarmonics; ++k)
+		{
+			binsDest[2 * k] = bins[2 * k] * gain;
+			binsDest[2 * k + 1] = bins[2 * k + 1] * gain;
+			if (k != 0)
+			{ // CONJUGATE NEGATIVE FREQUENCIES
+				binsDest[2 * (destSize - k)] = binsDest[2 * k];
+				binsDest[2 * (destSize - k) + 1] = -binsDest[2 * k + 1];
+			}
+		}
+		fftDest.performRealOnlyInverseTransform(binsDest.data());
+		std::copy(binsDest.begin(), binsDest.begin() + destSize, dest);
+	}
+
+	// picks numFrames frames evenly spread over the source and resamples them.
+	// sources with fewer frames than that repeat some, those only get resampled once
+	inline void makeFrames(const std::vector<float>& samples, std::vector<float>& frames, int numFrames, int frameSize)
+	{
+		const auto numSamples = static_cast<int>(samples.size());
+		const auto srcFrameSize = numSamples >= DefaultFrameSize && numSamples % DefaultFrameSize == 0 ?
+			DefaultFrameSize : numSamples;
+		const auto numSrcFrames = numSamples / srcFrameSize;
+
+		juce::dsp::FFT fft(static_cast<int>(std::round(std::log2(frameSize))));
+		frames.resize(numFrames * frameSize);
+		auto lastSrcFrame = -1;
+		for (auto f = 0; f < numFrames; ++f)
+		{
+			const auto srcFrame = numFrames == 1 ? 0 :
+				static_cast<int>(std::round(static_cast<float>(f * (numSrcFrames - 1)) / static_cast<float>(numFrames - 1)));
+			const auto frame = frames.data() + f * frameSize;
+			if (srcFrame == lastSrcFrame)
+				std::copy(frame - frameSize, frame, frame);
+			else
+				resampleFrame(samples.data() + srcFrame * srcFrameSize, srcFrameSize, frame, frameSize, fft);
+			lastSrcFrame = srcFrame;
+		}
+	}
+
+	// the cache is valid if it belongs to the source as it is now, or, if the source is gone,
+	// if it carries the expected hash (0 accepts any)
+	inline bool readCache(const juce::File& source, std::vector<float>& frames, int numFrames, int frameSize,
+		uint64_t expectedHash, uint64_t& hash)
+	{
+		const auto cacheFile = getCacheFile(source);
+		if (!cacheFile.existsAsFile())
+			return false;
+		juce::MemoryMappedFile mapped(cacheFile, juce::MemoryMappedFile::readOnly);
+		const auto framesSize = static_cast<size_t>(numFrames * frameSize) * sizeof(float);
+		if (mapped.getData() == nullptr || mapped.getSize() < sizeof(CacheHeader) + framesSize)
+			return false;
+
+		CacheHeader header;
+		std::memcpy(&header, mapped.getData(), sizeof(CacheHeader));
+		if (std::memcmp(header.magic, CacheMagic, 4) != 0 ||
+			header.numFrames != static_cast<uint32_t>(numFrames) ||
+			header.frameSize != static_cast<uint32_t>(frameSize))
+			return false;
+
+		if (source.existsAsFile())
+		{
+			if (header.sourceSize != static_cast<uint64_t>(source.getSize()) ||
+				header.sourceModTime != source.getLastModificationTime().toMilliseconds())
+				return false;
+		}
+		else if (expectedHash != 0 && expectedHash != header.hash)
+			return false;
+
+		frames.resize(numFrames * frameSize);
+		std::memcpy(frames.data(), static_cast<const char*>(mapped.getData()) + sizeof(CacheHeader), framesSize);
+		hash = header.hash;
+		return true;
+	}
+
+	inline void writeCache(const juce::File& source, const std::vector<float>& frames, int numFrames, int frameSize, uint64_t hash)
+	{
+		CacheHeader header;
+		std::memcpy(header.magic, CacheMagic, 4);
+		header.numFrames = static_cast<uint32_t>(numFrames);
+		header.frameSize = static_cast<uint32_t>(frameSize);
+		header.sourceSize = static_cast<uint64_t>(source.getSize());
+		header.sourceModTime = source.getLastModificationTime().toMilliseconds();
+		header.hash = hash;
+
+		juce::MemoryBlock block;
+		block.append(&header, sizeof(CacheHeader));
+		block.append(frames.data(), frames.size() * sizeof(float));
+		getCacheFile(source).replaceWithData(block.getData(), block.getSize());
+	}
+
+	// not realtime-safe, meant for a worker thread
+	inline bool load(const juce::File& source, std::vector<float>& frames, int numFrames, int frameSize,
+		uint64_t expectedHash, uint64_t& hash)
+	{
+		if (readCache(source, frames, numFrames, frameSize, expectedHash, hash))
+			return true;
+		std::vector<float> samples;
+		if (!source.existsAsFile() || !readSource(source, samples, hash))
+			return false;
+		makeFrames(samples, frames, numFrames, frameSize);
+		writeCache(source, frames, numFrames, frameSize, hash);
+		return true;
+	}
+}
@@ -1,5 +1,7 @@
 #pragma once
 #include <JuceHeader.h>
+#include "../Approx.h"
+#include "../Prng.h"
 
 namespace modSys6
 {
@@ -33,10 +35,21 @@ namespace modSys6
 
 		Depth, ModsMix, DryWetMix, WetGain, StereoConfig,
 
+		Curve0FreeSync, Curve0Speed, Curve0RateSync, Curve0Width,
+		Curve1FreeSync, Curve1Speed, Curve1RateSync, Curve1Width,
+
+		Freeze, FreezeBars,
+
 		NumParams
 	};
 	static constexpr int NumMSParams = static_cast<int>(PID::MSMacro3) + 1;
 	static constexpr int NumParamsPerMod = static_cast<int>(PID::Perlin1FreqHz) - NumMSParams;
+	// modulator slots. each one needs its block of parameters above
+	static constexpr int NumMods = 2;
+	static_assert(NumMSParams + NumMods * NumParamsPerMod == static_cast<int>(PID::Depth));
+	// the curves' parameters come after the older ones, so that saved connections and automation keep their indices
+	static constexpr int NumCurveParamsPerMod = static_cast<int>(PID::Curve1FreeSync) - static_cast<int>(PID::Curve0FreeSync);
+	static_assert(static_cast<int>(PID::Curve0FreeSync) + NumMods * NumCurveParamsPerMod == static_cast<int>(PID::Freeze));
 	static constexpr int NumParams = static_cast<int>(PID::NumParams);
 	inline juce::String toString(PID pID)
 	{
@@ -113,10 +126,24 @@ namespace modSys6
 		case PID::WetGain: return "Gain Wet";
 		case PID::StereoConfig: return "Stereo Config";
 
+		case PID::Curve0FreeSync: return "Curve 0 FreeSync";
+		case PID::Curve0Speed: return "Curve 0 Speed";
+		case PID::Curve0RateSync: return "Curve 0 Rate Sync";
+		case PID::Curve0Width: return "Curve 0 Width";
+		case PID::Curve1FreeSync: return "Curve 1 FreeSync";
+		case PID::Curve1Speed: return "Curve 1 Speed";
+		case PID::Curve1RateSync: return "Curve 1 Rate Sync";
+		case PID::Curve1Width: return "Curve 1 Width";
+
+		case PID::Freeze: return "Freeze";
+		case PID::FreezeBars: return "Freeze Bars";
+
 		default: return "";
 		}
 	}
 	inline int withOffset(PID p, int o) noexcept { return static_cast<int>(p) + o; }
+	// o is the slot's offset into the per mod parameters, like with withOffset
+	inline int withCurveOffset(PID p, int o) noexcept { return static_cast<int>(p) + o / NumParamsPerMod * NumCurveParamsPerMod; }
 
 	enum class Unit { Percent, Hz, Beats, Degree, Octaves, Semi, Fine, Ms, Decibel, NumUnits };
 	inline juce::String toString(Unit pID)
@@ -229,11 +256,15 @@ namespace modSys6
 			makeFromDecayInSamples(s, d * Fs * .001f);
 		}
 
+		// below this distance to the target the filter counts as settled
+		static constexpr float SettleEps = 1e-6f;
+
 		Smooth(const bool _snap = true, const float startVal = 0.f) :
 			a0(1.f),
 			b1(0.f),
 			y1(startVal),
-			eps(0.f),
+			eps(SettleEps),
+			k(-1.f),
 			snap(_snap)
 		{}
 		void reset()
@@ -241,17 +272,39 @@ namespace modSys6
 			a0 = 1.f;
 			b1 = 0.f;
 			y1 = 0.f;
-			eps = 0.f;
+			eps = SettleEps;
+			k = -1.f;
 		}
 		void setX(float x) noexcept
 		{
-			a0 = 1.f - x;
-			b1 = x;
-			eps = a0 * 1.5f;
+			setCoefficient(1.f - x);
+			k = -1.f;
+		}
+
+		// cached coefficient updates. these only recompute if the time constant changed
+		// and then use a fast exp, so they can be called per sample with modulated values
+		void setDecayInSamples(float d) noexcept
+		{
+			setK(1.f / d);
+		}
+		void setDecayInMs(float d, float Fs) noexcept
+		{
+			setK(1000.f / (d * Fs));
+		}
+		void setDecayInHz(float fc, float Fs) noexcept
+		{
+			setK(tau * fc / Fs);
 		}
+
+		// jumps to v without smoothing, like on a deterministic restart
+		void setValue(float v) noexcept { y1 = v; }
+
+		// the output reached the target, so processing it would only return the target
+		bool isSettled(float target) const noexcept { return y1 == target; }
+
 		void operator()(float* buffer, float val, int numSamples) noexcept
 		{
-			if (buffer[0] == val)
+			if (isSettled(val))
 				return juce::FloatVectorOperations::fill(buffer, val, numSamples);
 			for (auto s = 0; s < numSamples; ++s)
 				buffer[s] = processSample(val);
@@ -265,13 +318,89 @@ namespace modSys6
 		{
 			return processSample(sample);
 		}
+
+		// smooths the buffers of up to MaxLanes smoothers in place.
+		// the states get gathered into lanes, so that the independent recursions interleave
+		static constexpr int MaxLanes = 8;
+		static void processLanes(Smooth* const* smooths, float* const* buffers, int numLanes, int numSamples) noexcept
+		{
+			std::array<float, MaxLanes> a0L, b1L, y1L, epsL;
+			for (auto l = 0; l < numLanes; ++l)
+			{
+				a0L[l] = smooths[l]->a0;
+				b1L[l] = smooths[l]->b1;
+				y1L[l] = smooths[l]->y1;
+				epsL[l] = smooths[l]->eps;
+			}
+			for (auto s = 0; s < numSamples; ++s)
+				for (auto l = 0; l < numLanes; ++l)
+				{
+					const auto x0 = buffers[l][s];
+					const auto y = x0 * a0L[l] + y1L[l] * b1L[l];
+					y1L[l] = std::abs(y1L[l] - x0) < epsL[l] ? x0 : y;
+					buffers[l][s] = y1L[l];
+				}
+			for (auto l = 0; l < numLanes; ++l)
+				smooths[l]->y1 = y1L[l];
+		}
+		// like processLanes, but each lane's decay follows its own buffer of frequencies (in hz)
+		static void processLanesDecayInHz(Smooth* const* smooths, float* const* buffers, const float* const* freqs,
+			int numLanes, int numSamples, float Fs) noexcept
+		{
+			std::array<float, MaxLanes> a0L, b1L, y1L, epsL, kL;
+			for (auto l = 0; l < numLanes; ++l)
+			{
+				a0L[l] = smooths[l]->a0;
+				b1L[l] = smooths[l]->b1;
+				y1L[l] = smooths[l]->y1;
+				epsL[l] = smooths[l]->eps;
+				kL[l] = smooths[l]->k;
+			}
+			for (auto s = 0; s < numSamples; ++s)
+				for (auto l = 0; l < numLanes; ++l)
+				{
+					const auto k = tau * freqs[l][s] / Fs;
+					if (k != kL[l])
+					{
+						auto& smooth = *smooths[l];
+						smooth.setK(k);
+						a0L[l] = smooth.a0;
+						b1L[l] = smooth.b1;
+						epsL[l] = smooth.eps;
+						kL[l] = k;
+					}
+					const auto x0 = buffers[l][s];
+					const auto y = x0 * a0L[l] + y1L[l] * b1L[l];
+					y1L[l] = std::abs(y1L[l] - x0) < epsL[l] ? x0 : y;
+					buffers[l][s] = y1L[l];
+				}
+			for (auto l = 0; l < numLanes; ++l)
+				smooths[l]->y1 = y1L[l];
+		}
 	protected:
-		float a0, b1, y1, eps;
+		float a0, b1, y1, eps, k;
 		const bool snap;
 
+		void setCoefficient(float a) noexcept
+		{
+			a0 = a;
+			b1 = 1.f - a;
+			eps = snap ? std::max(a0 * 1.5f, SettleEps) : SettleEps;
+		}
+		// k = 1 / decay in samples, the coefficient is 1 - e^-k
+		void setK(float _k) noexcept
+		{
+			if (k == _k)
+				return;
+			k = _k;
+			setCoefficient(approx::oneMinusExp(k));
+		}
+
 		float processSample(float x0) noexcept
 		{
-			if (snap && std::abs(y1 - x0) < eps)
+			if (y1 == x0)
+				return y1;
+			if (std::abs(y1 - x0) < eps)
 				y1 = x0;
 			else
 				y1 = x0 * a0 + y1 * b1;
@@ -613,6 +742,8 @@ namespace modSys6
 			const auto valToStrMs = [](float v) { return juce::String(std::floor(v * 10.f) * .1f) + " " + toString(Unit::Ms); };
 			const auto valToStrDb = [](float v) { return juce::String(std::floor(v * 100.f) * .01f) + " " + toString(Unit::Decibel); };
 			const auto valToStrEmpty = [](float) { return juce::String(""); };
+			const auto valToStrSpeed = [](float v) { return juce::String(v).substring(0, 4) + "x"; };
+			const auto valToStrBars = [](float v) { return juce::String(1 << static_cast<int>(v)) + " bars"; };
 
 			const auto strToValPercent = [strToValDivision](const juce::String& txt)
 			{
@@ -646,6 +777,12 @@ namespace modSys6
 			const auto strToValPolarity = [](const juce::String& txt) { return txt[0] == '0' ? 0.f : 1.f; };
 			const auto strToValMs = [](const juce::String& txt) { return txt.trimCharactersAtEnd(toString(Unit::Ms)).getFloatValue(); };
 			const auto strToValDb = [](const juce::String& txt) { return txt.trimCharactersAtEnd(toString(Unit::Decibel)).getFloatValue(); };
+			const auto strToValSpeed = [](const juce::String& txt) { return txt.trimCharactersAtEnd("x").getFloatValue(); };
+			const auto strToValBars = [](const juce::String& txt)
+			{
+				const auto bars = juce::jmax(1, txt.trimCharactersAtEnd(" bars").getIntValue());
+				return std::floor(std::log2(static_cast<float>(bars)));
+			};
 
 			for (auto p = 0; p < NumMSParams; ++p)
 			{
@@ -735,7 +872,7 @@ namespace modSys6
 			}
 
 			// ADD NON MODSYS PARAMETERS HERE
-			for (auto m = 0; m < 2; ++m)
+			for (auto m = 0; m < NumMods; ++m)
 			{
 				const auto offset = m * NumParamsPerMod;
 				params.push_back(new Param(withOffset(PID::Perlin0FreqHz, offset), makeRange::biasXL(.2f, 20.f, -.8f), 6.f, valToStrHz, strToValHz, Unit::Hz));
@@ -781,6 +918,16 @@ namespace modSys6
 			params.push_back(new Param(PID::DryWetMix, makeRange::biasXL(0.f, 1.f, 0.f), 1.f, valToStrRatio, strToValRatio));
 			params.push_back(new Param(PID::WetGain, makeRange::biasXL(-120.f, 4.5f, .9f), 0.f, valToStrDb, strToValDb));
 			params.push_back(new Param(PID::StereoConfig, makeRange::toggle(), 1.f, valToStrLRMS, strToValLRMS));
+			for (auto m = 0; m < NumMods; ++m)
+			{
+				const auto offset = m * NumParamsPerMod;
+				params.push_back(new Param(withCurveOffset(PID::Curve0FreeSync, offset), makeRange::toggle(), 0.f, valToStrFreeSync, strToValFreeSync, Unit::NumUnits));
+				params.push_back(new Param(withCurveOffset(PID::Curve0Speed, offset), makeRange::biasXL(.125f, 8.f, -.8f), 1.f, valToStrSpeed, strToValSpeed, Unit::NumUnits));
+				params.push_back(new Param(withCurveOffset(PID::Curve0RateSync, offset), makeRange::temposync(static_cast<int>(beatsData.size()) - 1), 9.f, valToStrBeats, strToValBeats, Unit::Beats));
+				params.push_back(new Param(withCurveOffset(PID::Curve0Width, offset), makeRange::biasXL(0.f, .5f, 0.f), 0.f, valToStrPercent, strToValPercent, Unit::Percent));
+			}
+			params.push_back(new Param(PID::Freeze, makeRange::toggle(), 0.f, valToStrPolarity, strToValPolarity));
+			params.push_back(new Param(PID::FreezeBars, makeRange::stepped(0.f, 3.f), 2.f, valToStrBars, strToValBars));
 
 			for (auto param : params)
 				audioProcessor.addParameter(param);
@@ -956,36 +1103,30 @@ namespace modSys6
 	struct Connec
 	{
 		Connec() :
-			depth(0.f), enabled(0.f),
+			depth(0.f), enabled(false),
 			pIdx(0), mIdx(0)
 		{
 		}
-		void disable() noexcept { enabled = 0.f; }
+		void disable() noexcept { enabled = false; }
 		void enable(int _mIdx, int _pIdx, float _depth) noexcept
 		{
-			disable();
 			pIdx = _pIdx;
 			mIdx = _mIdx;
 			depth = _depth;
-			enabled = 1.f;
+			enabled = true;
 		}
 		void setDepth(float d) noexcept { depth = d; }
 		float getDepth() const noexcept { return depth; }
 		int getPIdx() const noexcept { return pIdx; }
 		int getMIdx() const noexcept { return mIdx; }
-		void processBlock(Params& params, const Mods& mods) noexcept
-		{
-			const auto val = mods[mIdx].val * depth * enabled;
-			params[pIdx]->processBlockModulate(val);
-		}
 		bool has(int _mIdx, int _pIdx) const noexcept
 		{
 			return isEnabled() && pIdx == _pIdx && mIdx == _mIdx;
 		}
-		bool isEnabled() const noexcept { return enabled > 0.f; }
+		bool isEnabled() const noexcept { return enabled; }
 		juce::String toString() const
 		{
-			if (enabled != 1.f) return "disabled";
+			if (!enabled) return "disabled";
 			return "m: " + juce::String(mIdx) + "; p: " + juce::String(pIdx);
 		}
 
@@ -998,24 +1139,65 @@ namespace modSys6
 			connexState.appendChild(state, nullptr);
 		}
 	protected:
-		float depth, enabled;
+		float depth;
+		bool enabled;
 		int pIdx, mIdx;
 	};
+
+	// the slots are what the gui edits, their indices stay valid while other connections change.
+	// each edit publishes the enabled ones as a compact list, sorted by parameter,
+	// into the half of a double buffer that the audio thread isn't reading.
+	// the audio thread never waits for the lock, a patch it loads gets applied once the lock is free
 	struct Connex
 	{
+		static constexpr int NumConnex = 256;
+
+		struct Active
+		{
+			int pIdx, mIdx;
+			float depth;
+		};
+		struct ActiveList
+		{
+			std::array<Active, NumConnex> connex;
+			int size;
+		};
+
 		Connex() :
-			connex()
-		{}
+			connex(),
+			lists(),
+			front(0), reading(-1),
+			publishMutex(),
+			patch(),
+			patchPending(false)
+		{
+			for (auto& list : lists)
+				list.size = 0;
+		}
 		bool enableConnection(int mIdx, int pIdx, float depth) noexcept
 		{
+			const juce::SpinLock::ScopedLockType lock(publishMutex);
 			for (auto c = 0; c < connex.size(); ++c)
 				if (!connex[c].isEnabled())
 				{
 					connex[c].enable(mIdx, pIdx, depth);
+					publish();
 					return true;
 				}
 			return false;
 		}
+		void disableConnection(int c) noexcept
+		{
+			const juce::SpinLock::ScopedLockType lock(publishMutex);
+			connex[c].disable();
+			publish();
+		}
+		void setConnecDepth(int c, float depth) noexcept
+		{
+			const juce::SpinLock::ScopedLockType lock(publishMutex);
+			connex[c].setDepth(depth);
+			publish();
+		}
 		int getConnecIdxWith(int mIdx, int pIdx) const noexcept
 		{
 			for (auto c = 0; c < connex.size(); ++c)
@@ -1023,31 +1205,47 @@ namespace modSys6
 					return c;
 			return -1;
 		}
+		// audio thread
 		void processBlock(Params& params, const Mods& mods) noexcept
 		{
-			for (auto& connec : connex)
-				connec.processBlock(params, mods);
+			applyPatch();
+			auto f = front.load();
+			reading.store(f);
+			// a publish might have happened between reading front and claiming it
+			while (front.load() != f)
+			{
+				f = front.load();
+				reading.store(f);
+			}
+			const auto& list = lists[f];
+			for (auto c = 0; c < list.size; ++c)
+			{
+				const auto& connec = list.connex[c];
+				params[connec.pIdx]->processBlockModulate(mods[connec.mIdx].val * connec.depth);
+			}
+			reading.store(-1);
 		}
 
-		Connec& operator[](int c) noexcept { return connex[c]; }
 		const Connec& operator[](int c) const noexcept { return connex[c]; }
 
-		void loadPatch(juce::ValueTree& state)
+		// the audio thread only tries the lock. if an edit holds it, the patch gets applied in a later processBlock
+		void loadPatch(juce::ValueTree& state, bool fromAudioThread)
 		{
 			StateIDs ids;
 			const auto connexState = state.getChildWithName(ids.connex);
 			if (!connexState.isValid()) return;
-			auto c = 0;
-			for (; c < connexState.getNumChildren(); ++c)
+			if (fromAudioThread)
 			{
-				const auto connecState = connexState.getChild(c);
-				const auto pIdx = connecState.getProperty(ids.param);
-				const auto mIdx = connecState.getProperty(ids.mod);
-				const auto depth = connecState.getProperty(ids.value);
-				connex[c].enable(mIdx, pIdx, depth);
+				parsePatch(patch, connexState, ids);
+				patchPending.store(true);
+				applyPatch();
+				return;
 			}
-			for (; c < connex.size(); ++c)
-				connex[c].disable();
+			const juce::SpinLock::ScopedLockType lock(publishMutex);
+			// this patch is newer than one the audio thread still waits to apply
+			patchPending.store(false);
+			parsePatch(connex, connexState, ids);
+			publish();
 		}
 		void savePatch(juce::ValueTree& state)
 		{
@@ -1061,25 +1259,78 @@ namespace modSys6
 			else
 				connexState.removeAllChildren(nullptr);
 			
+			const juce::SpinLock::ScopedLockType lock(publishMutex);
+			// disabled connections leave gaps between the enabled ones
 			for (auto c = 0; c < connex.size(); ++c)
 				if (connex[c].isEnabled())
 					connex[c].savePatch(connexState, ids);
-				else
-					return;
 		}
 
-		std::array<Connec, 256> connex;
-
 		juce::String toString() const
 		{
 			juce::String str("Connex:\n");
 			for (auto c = 0; c < connex.size(); ++c)
-				if (!connex[c].isEnabled())
-					return str;
-				else
+				if (connex[c].isEnabled())
 					str += "c: " + juce::String(c) + "; " + connex[c].toString() + "\n";
 			return str;
 		}
+	protected:
+		std::array<Connec, NumConnex> connex;
+		std::array<ActiveList, 2> lists;
+		std::atomic<int> front, reading;
+		// guards the slots and the back list. edits can come from the message thread
+		// and from patch loads on the audio thread
+		juce::SpinLock publishMutex;
+		// a patch loaded on the audio thread. only the audio thread touches it
+		std::array<Connec, NumConnex> patch;
+		std::atomic<bool> patchPending;
+
+		static void parsePatch(std::array<Connec, NumConnex>& dest, const juce::ValueTree& connexState, const StateIDs& ids)
+		{
+			auto c = 0;
+			for (; c < connexState.getNumChildren() && c < NumConnex; ++c)
+			{
+				const auto connecState = connexState.getChild(c);
+				const auto pIdx = connecState.getProperty(ids.param);
+				const auto mIdx = connecState.getProperty(ids.mod);
+				const auto depth = connecState.getProperty(ids.value);
+				dest[c].enable(mIdx, pIdx, depth);
+			}
+			for (; c < NumConnex; ++c)
+				dest[c].disable();
+		}
+
+		// audio thread
+		void applyPatch() noexcept
+		{
+			if (!patchPending.load())
+				return;
+			const juce::SpinLock::ScopedTryLockType lock(publishMutex);
+			if (!lock.isLocked() || !patchPending.load())
+				return;
+			connex = patch;
+			publish();
+			patchPending.store(false);
+		}
+
+		// call with publishMutex held
+		void publish() noexcept
+		{
+			const auto back = 1 - front.load();
+			// the audio thread might still read the list from before the last publish
+			while (reading.load() == back)
+				std::this_thread::yield();
+			auto& list = lists[back];
+			list.size = 0;
+			for (const auto& connec : connex)
+				if (connec.isEnabled())
+					list.connex[list.size++] = { connec.getPIdx(), connec.getMIdx(), connec.getDepth() };
+			std::sort(list.connex.begin(), list.connex.begin() + list.size, [](const Active& a, const Active& b)
+			{
+				return a.pIdx < b.pIdx;
+			});
+			front.store(back);
+		}
 	};
 
 	struct ModSys
@@ -1111,9 +1362,9 @@ namespace modSys6
 			wannaUpdatePatch.store(true);
 		}
 
-		void loadPatch()
+		void loadPatch(bool fromAudioThread = false)
 		{
-			connex.loadPatch(state);
+			connex.loadPatch(state, fromAudioThread);
 			params.loadPatch(state);
 		}
 		void savePatch()
@@ -1123,7 +1374,8 @@ namespace modSys6
 		}
 
 		// returns false if patch needs to be updated
-		bool processBlock(const float**, int numSamples, const juce::AudioPlayHead* playHead)
+		template<typename Float>
+		bool processBlock(const Float**, int numSamples, const juce::AudioPlayHead* playHead)
 		{
 			if (wannaUpdatePatch.load())
 			{
@@ -1206,16 +1458,14 @@ namespace modSys6
 		}
 		bool disableConnection(int cIdx) noexcept
 		{
-			const auto param = params[connex[cIdx].getPIdx()];
-			connex[cIdx].disable();
-			return true;	
+			connex.disableConnection(cIdx);
+			return true;
 		}
 
 		float getConnecDepth(int cIdx) const noexcept { return connex[cIdx].getDepth(); }
 		bool setConnecDepth(int cIdx, float depth) noexcept
 		{
-			const auto param = params[connex[cIdx].getPIdx()];
-			connex[cIdx].setDepth(depth);
+			connex.setConnecDepth(cIdx, depth);
 			return true;
 		}
 
@@ -2131,12 +2131,13 @@ namespace modSys6
         struct ParamtrRandomizer :
             public Comp
         {
-            using RandFunc = std::function<void(juce::Random&)>;
+            using RandFunc = std::function<void(prng::Xoshiro128&)>;
 
             ParamtrRandomizer(Utils& u, std::vector<Paramtr*>& _randomizables, juce::String&& _id) :
                 Comp(u, makeTooltip()),
                 randomizables(_randomizables),
                 randFuncs(),
+                rand(static_cast<uint64_t>(juce::Random::getSystemRandom().nextInt64())),
                 lock(u, this, std::move(_id))
             {
                 addAndMakeVisible(lock);
@@ -2145,6 +2146,7 @@ namespace modSys6
                 Comp(u, makeTooltip()),
                 randomizables(),
                 randFuncs(),
+                rand(static_cast<uint64_t>(juce::Random::getSystemRandom().nextInt64())),
                 lock(u, this, std::move(_id))
             {
                 addAndMakeVisible(lock);
@@ -2161,7 +2163,6 @@ namespace modSys6
             void operator()()
             {
                 if (lock.isLocked()) return;
-                juce::Random rand;
                 const auto r_depth = Shared::shared.r_depth;
                 for (auto& func : randFuncs)
                     func(rand);
@@ -2178,6 +2179,7 @@ namespace modSys6
         protected:
             std::vector<Paramtr*> randomizables;
             std::vector<RandFunc> randFuncs;
+            prng::Xoshiro128 rand;
             Lock lock;
 
             void resized() override
@@ -5,23 +5,24 @@ namespace oversampling
 {
 	// http://www.dspguide.com/ch16/1.htm
 
+	template<typename Float>
 	struct ImpulseResponse
 	{
 		ImpulseResponse() :
 			data(),
 			latency(0)
 		{
-			data.resize(1, 1.f);
+			data.resize(1, static_cast<Float>(1));
 		}
-		ImpulseResponse(const std::vector<float>& _data) :
+		ImpulseResponse(const std::vector<Float>& _data) :
 			data(_data),
 			latency(static_cast<int>(data.size()) / 2)
 		{
 		}
-		float operator[](int i) const noexcept { return data[i]; }
+		Float operator[](int i) const noexcept { return data[i]; }
 		const size_t size() const noexcept { return data.size(); }
 
-		std::vector<float> data;
+		std::vector<Float> data;
 		int latency;
 
 		void dbg() {
@@ -37,12 +38,13 @@ namespace oversampling
 	/*
 	* fc < Nyquist && bw < Nyquist && fc + bw < Nyquist
 	*/
-	static ImpulseResponse makeSincFilter2(float Fs, float fc, float bw, bool upsampling)
+	template<typename Float>
+	static ImpulseResponse<Float> makeSincFilter2(float Fs, float fc, float bw, bool upsampling)
 	{
 		const auto nyquist = Fs * .5f;
 		if (fc > nyquist || bw > nyquist || fc + bw > nyquist) { // invalid arguments
-			std::vector<float> ir;
-			ir.resize(1, 1.f);
+			std::vector<Float> ir;
+			ir.resize(1, static_cast<Float>(1));
 			return ir;
 		}
 		fc /= Fs;
@@ -64,16 +66,16 @@ namespace oversampling
 			return .42f - .5f * std::cos(tau * i) + .08f * std::cos(tau2 * i);
 		};
 
-		std::vector<float> ir;
+		std::vector<Float> ir;
 		ir.reserve(N);
 		for (auto n = 0; n < N; ++n)
 		{
 			auto nF = static_cast<float>(n);
-			ir.emplace_back(h(nF) * w(nF));
+			ir.emplace_back(static_cast<Float>(h(nF) * w(nF)));
 		}	
 
-		const auto targetGain = upsampling ? 2.f : 1.f;
-		auto sum = 0.f; // normalize
+		const auto targetGain = static_cast<Float>(upsampling ? 2 : 1);
+		auto sum = static_cast<Float>(0); // normalize
 		for (const auto n : ir)
 			sum += n;
 		const auto sumInv = targetGain / sum;
@@ -83,16 +85,19 @@ namespace oversampling
 		return ir;
 	}
 
+	template<typename Float>
 	struct Convolution
 	{
-		Convolution(const ImpulseResponse& ir) :
+		using IR = ImpulseResponse<Float>;
+
+		Convolution(const IR& ir) :
 			buffer(),
 			wIdx(0)
 		{
-			buffer.resize(ir.size(), 0.f);
+			buffer.resize(ir.size(), static_cast<Float>(0));
 		}
 
-		void processBlock(float* audioBuffer, const ImpulseResponse& ir, const int numSamples) noexcept
+		void processBlock(Float* audioBuffer, const IR& ir, const int numSamples) noexcept
 		{
 			for (auto s = 0; s < numSamples; ++s)
 			{
@@ -101,7 +106,7 @@ namespace oversampling
 					wIdx = 0;
 				buffer[wIdx] = audioBuffer[s];
 
-				auto y = 0.f;
+				auto y = static_cast<Float>(0);
 				auto rIdx = wIdx;
 				for (auto i = 0; i < ir.size(); ++i)
 				{
@@ -113,7 +118,7 @@ namespace oversampling
 				audioBuffer[s] = y;
 			}
 		}
-		void processBlockUp(float* audioBuffer, const ImpulseResponse& ir, const int numSamples) noexcept
+		void processBlockUp(Float* audioBuffer, const IR& ir, const int numSamples) noexcept
 		{
 			for (auto s = 0; s < numSamples; s += 2)
 			{
@@ -121,11 +126,11 @@ namespace oversampling
 				audioBuffer[s + 1] = processSampleUpOdd(ir);
 			}
 		}
-		float processSampleUpEven(const float sample, const ImpulseResponse& ir) noexcept
+		Float processSampleUpEven(const Float sample, const IR& ir) noexcept
 		{
 			const auto irSize = static_cast<int>(ir.size());
 			buffer[wIdx] = sample;
-			auto y = 0.f;
+			auto y = static_cast<Float>(0);
 			auto rIdx = wIdx;
 			for (auto i = 0; i < irSize; i += 2)
 			{
@@ -139,14 +144,14 @@ namespace oversampling
 				wIdx = 0;
 			return y;
 		}
-		float processSampleUpOdd(const ImpulseResponse& ir) noexcept
+		Float processSampleUpOdd(const IR& ir) noexcept
 		{
 			const auto irSize = static_cast<int>(ir.size());
-			auto y = 0.f;
+			auto y = static_cast<Float>(0);
 			auto rIdx = wIdx - 1;
 			if (rIdx == -1)
 				rIdx = irSize - 1;
-			buffer[wIdx] = 0.f;
+			buffer[wIdx] = static_cast<Float>(0);
 			for (auto i = 1; i < irSize; i += 2)
 			{
 				y += buffer[rIdx] * ir[i];
@@ -160,41 +165,42 @@ namespace oversampling
 			return y;
 		}
 	protected:
-		std::vector<float> buffer;
+		std::vector<Float> buffer;
 		int wIdx;
 	};
 
+	template<typename Float>
 	struct ConvolutionFilter
 	{
 		ConvolutionFilter(int _numChannels = 0, float _Fs = 1.f, float _cutoff = .25f, float _bandwidth = .25f, bool upsampling = false) :
 			filters(),
-			ir(_numChannels != 0 ? makeSincFilter2(_Fs, _cutoff, _bandwidth, upsampling) : ImpulseResponse()),
+			ir(_numChannels != 0 ? makeSincFilter2<Float>(_Fs, _cutoff, _bandwidth, upsampling) : ImpulseResponse<Float>()),
 			numChannels(_numChannels)
 		{
 			filters.resize(_numChannels, { ir });
 		}
 		int getLatency() const noexcept { return ir.latency; }
-		void processBlockDown(float** audioBuffer, int numSamples) noexcept
+		void processBlockDown(Float** audioBuffer, int numSamples) noexcept
 		{
 			for (auto ch = 0; ch < this->numChannels; ++ch)
 				filters[ch].processBlock(audioBuffer[ch], ir, numSamples);
 		}
-		void processBlockUp(float** audioBuffer, int numSamples) noexcept
+		void processBlockUp(Float** audioBuffer, int numSamples) noexcept
 		{
 			for (auto ch = 0; ch < this->numChannels; ++ch)
 				filters[ch].processBlockUp(audioBuffer[ch], ir, numSamples);
 		}
-		float processSampleUpEven(const float sample, const int ch) noexcept
+		Float processSampleUpEven(const Float sample, const int ch) noexcept
 		{
 			return filters[ch].processSampleUpEven(sample, ir);
 		}
-		float processSampleUpOdd(const int ch) noexcept 
+		Float processSampleUpOdd(const int ch) noexcept 
 		{
 			return filters[ch].processSampleUpOdd(ir);
 		}
 	protected:
-		std::vector<Convolution> filters;
-		ImpulseResponse ir;
+		std::vector<Convolution<Float>> filters;
+		ImpulseResponse<Float> ir;
 		int numChannels;
 	};
 }
\ No newline at end of file
@@ -242,7 +242,7 @@ namespace oversampling
 			for (auto ch = 0; ch < numChannels; ++ch)
 				filters[ch].processBlock(audioBuffer[ch], numSamples);
 		}
-		float processSample(Float sample, int ch) noexcept
+		Float processSample(Float sample, int ch) noexcept
 		{
 			return filters[ch].processSample(sample);
 		}
@@ -1,5 +1,6 @@
 #pragma once
 #include <array>
+#include <type_traits>
 #include "juce_audio_basics/juce_audio_basics.h"
 #include "Filter.h"
 #include "ConvolutionFilter.h"
@@ -12,6 +13,24 @@ namespace oversampling
 
 	inline juce::String getOversamplingOrderID() { return "oversamplingOrder"; }
 
+	template<typename Float>
+	struct Filters
+	{
+		Filters(int numChannels) :
+			up4(  numChannels, 176400.f, 22050.f, 44100.f, true), //  17 samples
+			down4(numChannels, 176400.f, 22050.f, 44100.f),
+			up2(numChannels),
+			down2(numChannels)
+		{}
+		int getLatency() const noexcept
+		{
+			return up2.getLatency() + down2.getLatency() + up4.getLatency() + down4.getLatency();
+		}
+
+		ConvolutionFilter<Float> up4, down4;
+		LowkeyChebyshevFilter<Float> up2, down2;
+	};
+
 	struct Processor
 	{
 		Processor(juce::AudioProcessor* p) :
@@ -20,12 +39,10 @@ namespace oversampling
 			numChannels(p->getChannelCountOfBus(false, 0)),
 			blockSize(0),
 
-			buffer(),
+			buffer(), bufferD(),
 
-			filterUp4(  numChannels, 176400.f, 22050.f, 44100.f, true), //  17 samples
-			filterDown4(numChannels, 176400.f, 22050.f, 44100.f),
-			filterUp2(numChannels),
-			filterDown2(numChannels),
+			filters(numChannels),
+			filtersD(numChannels),
 
 			FsUp(0.),
 			blockSizeUp(0),
@@ -41,9 +58,8 @@ namespace oversampling
 			audioProcessor(p.audioProcessor),
 			Fs(p.Fs),
 			numChannels(p.numChannels), blockSize(p.blockSize),
-			buffer(p.buffer),
-			filterUp2(p.filterUp2), filterUp4(p.filterUp4),
-			filterDown4(p.filterDown4), filterDown2(p.filterDown2),
+			buffer(p.buffer), bufferD(p.bufferD),
+			filters(p.filters), filtersD(p.filtersD),
 			FsUp(p.FsUp), blockSizeUp(p.blockSizeUp),
 			enabled(p.enabled.load()),
 			wannaUpdate(p.wannaUpdate.load()),
@@ -52,7 +68,8 @@ namespace oversampling
 		{
 		}
 		// prepare & params
-		void prepareToPlay(const double sampleRate, const int _blockSize)
+		// only the buffer of the used sample type gets memory
+		void prepareToPlay(const double sampleRate, const int _blockSize, bool doublePrecision)
 		{
 			Fs = sampleRate;
 			blockSize = _blockSize;
@@ -66,10 +83,13 @@ namespace oversampling
 				FsUp = sampleRate;
 				blockSizeUp = blockSize;
 			}
-			buffer.setSize(numChannels, blockSize * MaxOrder, false, false, false);
+			const auto bufferSize = blockSize * static_cast<int>(MaxOrder);
+			buffer.setSize(numChannels, doublePrecision ? 0 : bufferSize, false, false, false);
+			bufferD.setSize(numChannels, doublePrecision ? bufferSize : 0, false, false, false);
 		}
 		/* processing methods */
-		juce::AudioBuffer<float>* upsample(juce::AudioBuffer<float>& input, int numChannelsIn, int numChannelsOut)
+		template<typename Float>
+		juce::AudioBuffer<Float>* upsample(juce::AudioBuffer<Float>& input, int numChannelsIn, int numChannelsOut)
 		{
 			if (wannaUpdate.load())
 			{
@@ -80,12 +100,15 @@ namespace oversampling
 			}
 			if (enabled.load())
 			{
+				auto& buf = getBuffer<Float>();
+				auto& fltrs = getFilters<Float>();
+
 				numSamples1x = input.getNumSamples();
 				numSamples2x = numSamples1x * 2;
 				numSamples4x = numSamples1x * 4;
 
-				buffer.setSize(numChannels, numSamples4x, true, false, true);
-				auto samplesUp = buffer.getArrayOfWritePointers();
+				buf.setSize(numChannels, numSamples4x, true, false, true);
+				auto samplesUp = buf.getArrayOfWritePointers();
 				const auto samplesIn = input.getArrayOfReadPointers();
 				// zero stuffing + filter 2x
 				for (auto ch = 0; ch < numChannelsIn; ++ch)
@@ -97,10 +120,10 @@ namespace oversampling
 					{
 						const auto s2 = s * 2;
 						up[s2] = in[s];
-						up[s2 + 1] = 0.f;
+						up[s2 + 1] = static_cast<Float>(0);
 					}
 				}
-				filterUp2.processBlock(samplesUp, numSamples2x);
+				fltrs.up2.processBlock(samplesUp, numSamples2x);
 				// zero stuffing + filter 4x
 				const auto maxSample2x = numSamples2x - 1;
 				for (auto ch = 0; ch < numChannelsIn; ++ch)
@@ -110,28 +133,31 @@ namespace oversampling
 					for (auto s = maxSample2x; s > -1; --s)
 					{
 						const auto s2 = s * 2;
-						up[s2] = up[s] * 2.f;
-						up[s2 + 1] = 0.f;
+						up[s2] = up[s] * static_cast<Float>(2);
+						up[s2 + 1] = static_cast<Float>(0);
 					}
 				}
 				// filter 4x
-				filterUp4.processBlockUp(samplesUp, numSamples4x);
+				fltrs.up4.processBlockUp(samplesUp, numSamples4x);
 				if (numChannelsIn < numChannelsOut)
 					juce::FloatVectorOperations::copy(samplesUp[1], samplesUp[0], numSamples4x);
-				return &buffer;
+				return &buf;
 			}
 			return &input;
 		}
-		void downsample(juce::AudioBuffer<float>* outBuf, int numChannelsOut) noexcept
+		template<typename Float>
+		void downsample(juce::AudioBuffer<Float>* outBuf, int numChannelsOut) noexcept
 		{
-			auto samplesUp = buffer.getArrayOfWritePointers();
+			auto& buf = getBuffer<Float>();
+			auto& fltrs = getFilters<Float>();
+			auto samplesUp = buf.getArrayOfWritePointers();
 			auto samplesOut = outBuf->getArrayOfWritePointers();
-			filterDown4.processBlockDown(samplesUp, numSamples4x);
+			fltrs.down4.processBlockDown(samplesUp, numSamples4x);
 			for (auto ch = 0; ch < numChannels; ++ch)
 				for (auto s = 0; s < numSamples2x; ++s)
 					samplesUp[ch][s] = samplesUp[ch][s * 2];
-			filterDown2.processBlock(samplesUp, numSamples2x);
-			if (numChannelsOut == buffer.getNumChannels())
+			fltrs.down2.processBlock(samplesUp, numSamples2x);
+			if (numChannelsOut == buf.getNumChannels())
 			{
 				for (auto ch = 0; ch < numChannels; ++ch)
 				{
@@ -185,7 +211,7 @@ namespace oversampling
 		int getLatency() const noexcept
 		{
 			if (enabled.load())
-				return filterUp2.getLatency() + filterDown2.getLatency() + filterUp4.getLatency() + filterDown4.getLatency();
+				return filters.getLatency();
 			return 0;
 		}
 		static constexpr int getUpsamplingFactor() noexcept { return 4; }
@@ -195,9 +221,10 @@ namespace oversampling
 		int numChannels, blockSize;
 
 		juce::AudioBuffer<float> buffer;
+		juce::AudioBuffer<double> bufferD;
 
-		ConvolutionFilter filterUp4, filterDown4;
-		LowkeyChebyshevFilter<float> filterUp2, filterDown2;
+		Filters<float> filters;
+		Filters<double> filtersD;
 
 		double FsUp;
 		int blockSizeUp;
@@ -207,6 +234,23 @@ namespace oversampling
 		bool enabledTmp;
 
 		int numSamples1x, numSamples2x, numSamples4x;
+
+		template<typename Float>
+		juce::AudioBuffer<Float>& getBuffer() noexcept
+		{
+			if constexpr (std::is_same<Float, double>::value)
+				return bufferD;
+			else
+				return buffer;
+		}
+		template<typename Float>
+		Filters<Float>& getFilters() noexcept
+		{
+			if constexpr (std::is_same<Float, double>::value)
+				return filtersD;
+			else
+				return filters;
+		}
 	};
 }
 
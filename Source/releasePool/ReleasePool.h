@@ -64,6 +64,13 @@ struct RealtimePtr
     {
         ReleasePool::theReleasePool.add(curPtr);
     }
+    RealtimePtr(const std::shared_ptr<Type>& ptr) :
+        curPtr(ptr),
+        updatedPtr(curPtr),
+        spinLock()
+    {
+        ReleasePool::theReleasePool.add(curPtr);
+    }
     ~RealtimePtr()
     {
         curPtr.reset(); updatedPtr.reset();
@@ -87,6 +94,13 @@ struct RealtimePtr
     {
         return updatedPtr;
     }
+    std::shared_ptr<Type> loadUpdatedPtr()
+    {
+        spinLock.enter();
+        auto ptr = updatedPtr;
+        spinLock.exit();
+        return ptr;
+    }
     std::shared_ptr<Type> updateAndLoadCurrentPtr() noexcept
     {
         if (curPtr != updatedPtr)